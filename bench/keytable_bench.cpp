@@ -0,0 +1,82 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <map>
+#include <vector>
+
+#include "../ceckeymap.h"
+#include "../keytable/keytable.h"
+
+// Compares the std::map keymap lookup with the flat KeyTable lookup over a
+// stream of control codes that is mostly mapped with some unmapped codes
+// mixed in, as seen on the libcec callback thread.
+
+static const size_t LOOKUPS = 20000000;
+
+int main(void)
+{
+  std::vector<CEC::cec_user_control_code> codes;
+  std::mt19937 rng(1234);
+
+  for (size_t i = 0;
+       i < sizeof(cec_code_names) / sizeof(cec_code_names[0]); i++)
+  {
+    codes.push_back(cec_code_names[i].cec_control_code);
+  }
+
+  std::map<CEC::cec_user_control_code, int> cec_to_key;
+  KeyTable::KeyTable table;
+
+  for (size_t i = 0;
+       i < sizeof(default_cec_to_key) / sizeof(default_cec_to_key[0]); i++)
+  {
+    cec_to_key[default_cec_to_key[i].cec_control_code] =
+      default_cec_to_key[i].input_key;
+    table.set(default_cec_to_key[i].cec_control_code,
+              default_cec_to_key[i].input_key);
+  }
+
+  std::vector<CEC::cec_user_control_code> stream(4096);
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    stream[i] = codes[rng() % codes.size()];
+  }
+
+  long map_sum = 0;
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < LOOKUPS; i++)
+  {
+    std::map<CEC::cec_user_control_code, int>::iterator it =
+      cec_to_key.find(stream[i & (stream.size() - 1)]);
+    map_sum += (it == cec_to_key.end()) ? -1 : it->second;
+  }
+
+  std::chrono::steady_clock::time_point middle =
+    std::chrono::steady_clock::now();
+
+  long table_sum = 0;
+  for (size_t i = 0; i < LOOKUPS; i++)
+  {
+    table_sum += table.lookup(stream[i & (stream.size() - 1)]);
+  }
+
+  std::chrono::steady_clock::time_point end =
+    std::chrono::steady_clock::now();
+
+  double map_ns =
+    std::chrono::duration<double, std::nano>(middle - start).count();
+  double table_ns =
+    std::chrono::duration<double, std::nano>(end - middle).count();
+
+  if (map_sum != table_sum)
+  {
+    std::cerr << "lookup results differ" << std::endl;
+    return 1;
+  }
+
+  std::cout << "std::map lookup: " << map_ns / LOOKUPS << " ns" << std::endl
+            << "KeyTable lookup: " << table_ns / LOOKUPS << " ns" << std::endl;
+  return 0;
+}
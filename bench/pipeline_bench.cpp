@@ -0,0 +1,187 @@
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../ceckeymap.h"
+#include "../inputdevice/inputdevice.h"
+#include "../keypipeline/keypipeline.h"
+
+// Drives the real cecKeyPressCB -> key queue -> InputDevice path without a
+// CEC adapter or uinput. Simulated remote presses are fed into the libcec
+// callback from one or more threads and the input device writes its events
+// to a plain file (by default /dev/null) instead of /dev/uinput.
+
+static double cpuSeconds(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+
+static void print_usage(std::string prog_name)
+{
+    std::cout << std::endl << "usage: " << prog_name << " [options]"
+      << std::endl << std::endl << "options:"
+      << std::endl << "\t-t {threads} - keypress generator threads (default: 1)"
+      << std::endl << "\t-r {rate}    - keys/s per generator, 0 for unthrottled (default: 0)"
+      << std::endl << "\t-s {seconds} - run time (default: 5)"
+      << std::endl << "\t-q {size}    - key queue size (default: 256)"
+      << std::endl << "\t-u {file}    - input device sink (default: /dev/null)"
+      << std::endl << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int threads = 1;
+  int rate = 0;
+  int seconds = 5;
+  int queue_size = 256;
+  std::string sink = "/dev/null";
+
+  int opt_return;
+  while ((opt_return = getopt(argc, argv, "t:r:s:q:u:h?")) != -1)
+  {
+    switch (opt_return)
+    {
+      case 't':
+        threads = atoi(optarg);
+        break;
+      case 'r':
+        rate = atoi(optarg);
+        break;
+      case 's':
+        seconds = atoi(optarg);
+        break;
+      case 'q':
+        queue_size = atoi(optarg);
+        break;
+      case 'u':
+        sink = optarg;
+        break;
+      default:
+        print_usage(argv[0]);
+        return -1;
+    }
+  }
+
+  if ((threads < 1) || (rate < 0) || (seconds < 1) || (queue_size < 1))
+  {
+    print_usage(argv[0]);
+    return -1;
+  }
+
+  UserInputDevice::InputDevice* id;
+  try
+  {
+    id = new UserInputDevice::InputDevice(sink);
+  }
+  catch(UserInputDevice::InputDeviceException& e)
+  {
+    std::cerr << "Can't open input device sink: " << e.what() << std::endl;
+    return -1;
+  }
+
+  KeyPipeline::KeyPipeline pipeline(id, queue_size, KeyQueue::DROP_NEWEST,
+                                    false);
+  KeyTable::KeyTable key_table;
+
+  for (size_t i = 0;
+       i < sizeof(default_cec_to_key) / sizeof(default_cec_to_key[0]); i++)
+  {
+    key_table.set(default_cec_to_key[i].cec_control_code,
+                  default_cec_to_key[i].input_key);
+  }
+
+  pipeline.setKeyTable(key_table);
+
+  std::thread dispatcher(&KeyPipeline::KeyPipeline::run, &pipeline);
+  std::atomic<bool> generating(true);
+  std::atomic<uint64_t> generated(0);
+  std::vector<std::thread> generators;
+
+  double cpu_start = cpuSeconds();
+  uint64_t start_ns = Stats::monotonicNs();
+
+  for (int t = 0; t < threads; t++)
+  {
+    generators.push_back(std::thread([&, t]()
+    {
+      const size_t codes = sizeof(default_cec_to_key) /
+                           sizeof(default_cec_to_key[0]);
+      uint64_t interval_ns = rate ? 1000000000ULL / rate : 0;
+      uint64_t next_ns = Stats::monotonicNs();
+      uint64_t count = 0;
+
+      CEC::cec_keypress keypress;
+      keypress.duration = 0;
+
+      while (generating)
+      {
+        keypress.keycode =
+          default_cec_to_key[(t + count) % codes].cec_control_code;
+        KeyPipeline::KeyPipeline::cecKeyPressCB(&pipeline, &keypress);
+        count++;
+
+        if (interval_ns)
+        {
+          next_ns += interval_ns;
+          uint64_t now_ns = Stats::monotonicNs();
+          if (next_ns > now_ns)
+          {
+            usleep((next_ns - now_ns) / 1000);
+          }
+        }
+      }
+
+      generated += count;
+    }));
+  }
+
+  sleep(seconds);
+  generating = false;
+
+  for (size_t i = 0; i < generators.size(); i++)
+  {
+    generators[i].join();
+  }
+
+  while (pipeline.queue().size() > 0)
+  {
+    usleep(1000);
+  }
+
+  uint64_t elapsed_ns = Stats::monotonicNs() - start_ns;
+  double cpu = cpuSeconds() - cpu_start;
+
+  pipeline.stop();
+  dispatcher.join();
+  delete id;
+
+  const Stats::PipelineStats& stats = pipeline.stats();
+  uint64_t emitted = stats.cec_keys;
+
+  std::cout << "generated:      " << generated << " keys" << std::endl
+            << "emitted:        " << emitted << " keys" << std::endl
+            << "dropped:        " << pipeline.queue().overflows() << " keys"
+            << std::endl
+            << "throughput:     " << emitted * 1e9 / elapsed_ns << " keys/s"
+            << std::endl
+            << "latency p50:    " << stats.cec_latency_ns.percentile(50.0) / 1000.0
+            << " us" << std::endl
+            << "latency p99:    " << stats.cec_latency_ns.percentile(99.0) / 1000.0
+            << " us" << std::endl
+            << "latency max:    " << stats.cec_latency_ns.max() / 1000.0
+            << " us" << std::endl
+            << "wakeups:        " << stats.wakeups << std::endl
+            << "cpu per key:    " << (emitted ? cpu * 1e6 / emitted : 0)
+            << " us" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include "binaryprotocol.h"
+
+#include <stdio.h>
+
+namespace BinaryProtocol
+{
+  static uint16_t readUint16(const uint8_t* bytes)
+  {
+    return (uint16_t) (bytes[0] | (bytes[1] << 8));
+  }
+
+
+  bool parseRequest(const void* frame, size_t size, Request* request)
+  {
+    const uint8_t* bytes = static_cast<const uint8_t*>(frame);
+
+    if (size < HEADER_SIZE)
+    {
+      request->version = VERSION;
+      request->command = 0;
+      request->sequence = 0;
+      request->payload = NULL;
+      request->payload_size = 0;
+      return false;
+    }
+
+    request->version = bytes[0];
+    request->command = bytes[1];
+    request->sequence = readUint16(bytes + 2);
+    request->payload = bytes + HEADER_SIZE;
+    request->payload_size = size - HEADER_SIZE;
+
+    return request->version == VERSION;
+  }
+
+
+  size_t keyCount(const Request& request)
+  {
+    if ((request.payload_size == 0) || (request.payload_size % 2 != 0) ||
+        (request.payload_size / 2 > MAX_KEYS))
+    {
+      return 0;
+    }
+
+    return request.payload_size / 2;
+  }
+
+
+  uint16_t keyAt(const Request& request, size_t index)
+  {
+    return readUint16(request.payload + index * 2);
+  }
+
+
+  bool parseCECCommand(const Request& request, uint8_t* cec_command,
+                       uint16_t* argument)
+  {
+    if (request.payload_size != 3)
+    {
+      return false;
+    }
+
+    *cec_command = request.payload[0];
+    *argument = readUint16(request.payload + 1);
+    return true;
+  }
+
+
+  bool formatTransmit(const Request& request,
+                      char text[TRANSMIT_TEXT_SIZE])
+  {
+    if ((request.payload_size == 0) ||
+        (request.payload_size > MAX_TRANSMIT_BYTES))
+    {
+      return false;
+    }
+
+    // each byte after the first also takes a separator
+    size_t offset = 0;
+    for (size_t i = 0; i < request.payload_size; i++)
+    {
+      offset += snprintf(text + offset, TRANSMIT_TEXT_SIZE - offset,
+                         (i == 0) ? "%02x" : ":%02x", request.payload[i]);
+    }
+
+    return true;
+  }
+
+
+  void encodeResponse(const Request& request, Status status,
+                      uint8_t response[RESPONSE_SIZE])
+  {
+    response[0] = VERSION;
+    response[1] = request.command;
+    response[2] = (uint8_t) (request.sequence & 0xff);
+    response[3] = (uint8_t) (request.sequence >> 8);
+    response[4] = (uint8_t) status;
+  }
+};
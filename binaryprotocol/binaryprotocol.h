@@ -0,0 +1,90 @@
+#ifndef BINARYPROTOCOL_H
+#define BINARYPROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact websocket protocol used for binary frames. All multi-byte fields
+// are little-endian.
+//
+// request:  | version (1) | command | sequence (2) | payload ... |
+// response: | version (1) | command | sequence (2) | status      |
+//
+// KEY_TAP, KEY_PRESS, KEY_RELEASE payload: one or more 16 bit key codes,
+// which are queued together in order.
+// CEC payload: | cec command | argument (2) | for ON and STANDBY the
+// argument is a logical address, for SET_ADDR_ACTIVE a physical address.
+// CEC_TRANSMIT payload: the raw bytes of the CEC frame, header first.
+
+namespace BinaryProtocol
+{
+  static const uint8_t VERSION = 1;
+  static const size_t HEADER_SIZE = 4;
+  static const size_t RESPONSE_SIZE = HEADER_SIZE + 1;
+  static const size_t MAX_KEYS = 64;
+  static const size_t MAX_TRANSMIT_BYTES = 16;
+  // "10:04:05" style text for the largest CEC_TRANSMIT payload
+  static const size_t TRANSMIT_TEXT_SIZE = MAX_TRANSMIT_BYTES * 3;
+
+  enum Command
+  {
+    CMD_KEY_TAP      = 0x01,
+    CMD_KEY_PRESS    = 0x02,
+    CMD_KEY_RELEASE  = 0x03,
+    CMD_CEC          = 0x10,
+    CMD_CEC_TRANSMIT = 0x11
+  };
+
+  enum CECCommand
+  {
+    CEC_ON              = 0x01,
+    CEC_STANDBY         = 0x02,
+    CEC_SET_ADDR_ACTIVE = 0x03,
+    CEC_ACTIVATE        = 0x04,
+    CEC_DEACTIVATE      = 0x05,
+    CEC_VOLUP           = 0x06,
+    CEC_VOLDOWN         = 0x07,
+    CEC_MUTE            = 0x08
+  };
+
+  enum Status
+  {
+    STATUS_OK              = 0x00,
+    STATUS_BAD_FRAME       = 0x01,
+    STATUS_UNKNOWN_COMMAND = 0x02,
+    STATUS_BAD_ARGUMENT    = 0x03,
+    STATUS_QUEUE_FULL      = 0x04,
+    STATUS_FAILED          = 0x05,
+    STATUS_BUSY            = 0x06  // rate limited, or too much work queued
+  };
+
+  struct Request
+  {
+    uint8_t version;
+    uint8_t command;
+    uint16_t sequence;
+    const uint8_t* payload;
+    size_t payload_size;
+  };
+
+  // points the request at the frame's payload, nothing is copied
+  bool parseRequest(const void* frame, size_t size, Request* request);
+
+  // number of 16 bit key codes in a key command's payload, or 0 if the
+  // payload is malformed
+  size_t keyCount(const Request& request);
+  uint16_t keyAt(const Request& request, size_t index);
+
+  bool parseCECCommand(const Request& request, uint8_t* cec_command,
+                       uint16_t* argument);
+
+  // writes a CEC_TRANSMIT payload in the format cec-client and the JSON
+  // protocol use, e.g. "10:04". Returns false if the payload is empty or
+  // too long.
+  bool formatTransmit(const Request& request,
+                      char text[TRANSMIT_TEXT_SIZE]);
+
+  void encodeResponse(const Request& request, Status status,
+                      uint8_t response[RESPONSE_SIZE]);
+};
+#endif
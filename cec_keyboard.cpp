@@ -1,10 +1,17 @@
 #include <iostream>
+#include <fstream>
+#include <stdio.h>
 #include <signal.h>
 #include <getopt.h>
 #include <pthread.h>
-#include <mutex>
+#include <unistd.h>
 #include <atomic>
-#include <queue>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <libcec/cec.h>
 #include <libcec/cecloader.h>
@@ -16,7 +23,23 @@
 #include <yaml-cpp/yaml.h>
 
 #include "ceckeymap.h"
+#include "binaryprotocol/binaryprotocol.h"
+#include "cecadapter/cecadapter.h"
+#include "ceccache/ceccache.h"
+#include "cecexecutor/cecexecutor.h"
+#include "cecsimulator/cecsimulator.h"
+#include "configreloader/configreloader.h"
+#include "eventstream/eventstream.h"
 #include "inputdevice/inputdevice.h"
+#include "keypipeline/keypipeline.h"
+#include "keytable/keytable.h"
+#include "logger/logger.h"
+#include "macrorunner/macrorunner.h"
+#include "metrics/metrics.h"
+#include "ratelimiter/ratelimiter.h"
+#include "recorder/recorder.h"
+#include "scheduler/scheduler.h"
+#include "stats/stats.h"
 
 // build deps: libcec4-dev cmake libyaml-cpp-dev libwebsocketpp-dev libboost-system-dev libjsoncpp-dev
 // deps: libcec4 libyaml-cpp0.5v5 libjsoncpp1
@@ -25,63 +48,280 @@ uint32_t cecRepeatRateMs       = 250;
 uint32_t cecReleaseDelayMs     = 0;
 uint32_t cecDoubleTapTimeoutMs = 650;
 std::string cecDeviceName      = "cec_keyboard";
+bool cecKernelRepeat           = false;
+uint32_t keyQueueSize          = 256;
+KeyQueue::OverflowPolicy keyQueueOverflow = KeyQueue::DROP_NEWEST;
 int ws_port = -1;
+uint32_t wsThreads = 1;
+uint32_t eventBufferBytes = 65536;
+uint32_t macroDelayMs = 100;
+uint32_t cacheTtlMs = 30000;
+bool cecSimulate = false;
+// key rate, latency and failure rate of the simulated bus
+CECSimulator::Settings simSettings = {0, 40, 0};
+Logger::Level logLevel = Logger::LEVEL_INFO;
+Logger::Output logOutput = Logger::OUTPUT_CONSOLE;
+// per client rate, burst and the cap on work queued by all clients
+RateLimiter::Limit rateLimits[RateLimiter::TARGETS] =
+{
+  {50, 100, 64}, // key
+  {10, 20, 32}   // cec
+};
+std::string configFile;
+std::string adapterCacheFile   = "/var/cache/cec_keyboard_adapter";
+std::string recordFile;
+std::string replayFile;
+double replaySpeed = 1;
 
 volatile std::atomic<bool> kill_main;
-std::mutex key_mutex;
-std::queue<int> key_queue;
+std::atomic<bool> startup_failed(false);
+uint64_t startup_ns;
+// the top level keymap, used by every adapter without one of its own
+KeyTable::KeyTable cec_key_table;
+ConfigReloader::ConfigReloader* config_reloader = NULL;
+// set before any thread that receives input starts, when recording
+Recorder::Recorder* recorder = NULL;
+Scheduler::Scheduler* key_scheduler = NULL;
+
+
+// Everything belonging to one CEC adapter. Each has its own keymap, input
+// device, key queue and dispatch thread, so a busy adapter never holds up
+// the key presses of another.
+struct AdapterContext
+{
+  std::string id;
+  uint8_t index;               // position in adapters, used in recordings
+  std::string cec_device_name; // empty to autodetect
+  std::string ui_device_name;
+  std::string input_name;      // what the input device is listed as
+  std::string osd_name;
+
+  // the keymap as last loaded, the key pipeline has its own copy
+  KeyTable::KeyTable key_table;
+  std::mutex key_table_mutex;
+  KeyPipeline::KeyPipeline* key_pipeline;
+  MacroRunner::MacroRunner* macro_runner;
+  UserInputDevice::InputDevice* input_device;
+
+  // libcec keeps pointers to the configuration's callbacks
+  CEC::ICECCallbacks cec_callbacks;
+  CEC::libcec_configuration cec_config;
+  CECAdapter::CECAdapter* cec_adapter;
+  // set once the adapter has been opened, until then CEC commands fail
+  std::atomic<CECExecutor::CECExecutor*> cec_executor;
+  // bus state for the query commands, created alongside the executor
+  std::atomic<CECCache::CECCache*> cec_cache;
+
+  std::thread cec_thread;
+  std::thread dispatch_thread;
+
+  AdapterContext(void) :
+    index(0), key_pipeline(NULL), macro_runner(NULL), input_device(NULL),
+    cec_adapter(NULL), cec_executor(NULL), cec_cache(NULL)
+  {
+  }
+};
+
+// in configuration order, the first is used by requests that don't name
+// one. The list is complete before any thread starts.
+std::vector<AdapterContext*> adapters;
+std::atomic<bool> adapters_ready(false);
 
-CEC::ICECAdapter* cec_adapter;
 websocketpp::server<websocketpp::config::asio> ws_server;
 
+// created by the websocket thread once the server is set up, bus events are
+// published from libcec's threads
+std::atomic<EventStream::EventStream*> event_stream(NULL);
+std::atomic<RateLimiter::RateLimiter*> rate_limiter(NULL);
+std::atomic<uint64_t> ws_connections(0);
+
+// websocket responses may be sent from the CEC executor thread once a bus
+// operation completes, so handlers answer through these
+typedef std::function<void(const Json::Value&)> JsonResponder;
+typedef std::function<void(BinaryProtocol::Status)> BinaryResponder;
+
+// sends a frame back to the client a message came from, replayed messages
+// have nowhere to go
+typedef std::function<void(const void* frame, size_t size,
+                           websocketpp::frame::opcode::value opcode)>
+  FrameSender;
+
 
 void* ws_loop(void*);
 
+void connectCEC(AdapterContext* context);
+
+CECAdapter::CECAdapter* openLibCEC(AdapterContext* context,
+                                   uint64_t phase_ns);
+
+std::string readCachedAdapter(void);
+
+void writeCachedAdapter(const std::string& cec_device_name);
+
+void logStartupTime(const std::string& phase, uint64_t phase_start_ns);
+
+void stopStartup(void);
+
+void stopDispatch(void);
+
+void cecKeyPressCB(void* cbparam, const CEC::cec_keypress* msg);
+
+void replayLog(Recorder::Player* player);
+
 void read_config_yaml(std::string config_file);
 
-void cecKeyPressCB(void*, const CEC::cec_keypress* msg);
+void loadDefaultKeymap(KeyTable::KeyTable* key_table);
+
+bool parseKeymap(const YAML::Node& config, KeyTable::KeyTable* key_table,
+                 std::string* error);
+
+bool parseAdapterKeymap(const YAML::Node& config, const std::string& id,
+                        KeyTable::KeyTable* key_table, std::string* error);
+
+AdapterContext* findAdapter(const std::string& id);
+
+bool reloadKeymap(std::string* message);
+
+void sendJson(const FrameSender& send, const Json::Value& responseJson);
+
+void handleMessage(const std::string& payload, bool binary,
+                   uint64_t received_ns, websocketpp::connection_hdl hdl,
+                   AdapterContext* context, const FrameSender& send);
+
+void handleCommand(const Json::Value& request, uint64_t received_ns,
+                   websocketpp::connection_hdl hdl, AdapterContext* context,
+                   JsonResponder respond);
+
+void handleBatch(const Json::Value& requests, uint64_t received_ns,
+                 websocketpp::connection_hdl hdl, AdapterContext* context,
+                 JsonResponder respond);
+
+void handleEventsCommand(const std::string& command,
+                         const std::string& arguments,
+                         websocketpp::connection_hdl hdl,
+                         Json::Value* responseJson);
+
+bool handleCECQuery(AdapterContext* context, const std::string& command,
+                    const std::string& arguments, Json::Value* responseJson);
+
+bool admitWork(websocketpp::connection_hdl hdl, AdapterContext* context,
+               RateLimiter::Target target, size_t count,
+               Json::Value* responseJson);
 
-bool execCECCommand(std::string cmd, std::string args, std::string response);
+Json::Value cecDeviceToJson(AdapterContext* context,
+                            CEC::cec_logical_address address,
+                            const CECCache::Device& device, uint64_t now_ns);
+
+BinaryProtocol::Status queueBinaryKeys(const BinaryProtocol::Request& request,
+                                       uint64_t received_ns,
+                                       websocketpp::connection_hdl hdl,
+                                       AdapterContext* context);
+
+bool transmitRoundTrips(CECAdapter::CECAdapter* adapter,
+                        const BinaryProtocol::Request& request,
+                        const char* arguments);
+
+bool execBinaryCECCommand(const BinaryProtocol::Request& request,
+                          websocketpp::connection_hdl hdl,
+                          AdapterContext* context, BinaryResponder respond);
+
+void handleBinaryMessage(const FrameSender& send,
+                         websocketpp::connection_hdl hdl,
+                         AdapterContext* context, const std::string& payload,
+                         uint64_t received_ns);
+
+AdapterContext* connectionAdapter(
+  websocketpp::server<websocketpp::config::asio>* serv,
+  websocketpp::connection_hdl hdl);
+
+bool wsValidateCB(websocketpp::server<websocketpp::config::asio>* serv,
+                  websocketpp::connection_hdl hdl);
 
 void wsMessageCB(websocketpp::server<websocketpp::config::asio>* s,
                  websocketpp::connection_hdl hdl,
                  websocketpp::server<websocketpp::config::asio>::message_ptr msg);
 
+void wsOpenCB(websocketpp::connection_hdl hdl);
+
+void wsCloseCB(websocketpp::connection_hdl hdl);
+
+void wsHttpCB(websocketpp::server<websocketpp::config::asio>* serv,
+              websocketpp::connection_hdl hdl);
+
+void publishKeyEvent(AdapterContext* context, const CEC::cec_keypress& msg,
+                     const KeyTable::KeyTable& key_table);
+
+void playCECMacro(AdapterContext* context, const KeyTable::Macro& macro);
+
+void runMacroCommand(AdapterContext* context, websocketpp::connection_hdl hdl,
+                     const std::string& command, const std::string& arguments,
+                     Json::Value responseJson, JsonResponder respond);
+
+void cecCommandCB(void* cbparam, const CEC::cec_command* command);
+
+void cecSourceActivatedCB(void* cbparam,
+                          const CEC::cec_logical_address address,
+                          const uint8_t activated);
+
 void print_usage(std::string prog_name);
 
 void sigintHandler(int signal);
 
-bool getCECControlCode(std::string control_code_str,
-                       CEC::cec_user_control_code* cec_control_code);
+void sighupHandler(int signal);
 
-bool getInputKeyCode(std::string input_key_str, int* input_key);
+Json::Value histogramToJson(const Stats::Histogram& histogram,
+                            uint64_t divisor);
 
-bool translateCECToKeyCode(CEC::cec_user_control_code cec_control_code,
-                           int* input_key);
+Json::Value statsToJson(AdapterContext* context);
 
-std::string getCECControlStr(CEC::cec_user_control_code cec_control_code);
+Json::Value adaptersToJson(void);
+
+std::string metricsText(void);
 
 void dump_keymap(void);
 
 int main(int argc, char* argv[])
 {
+  startup_ns = Stats::monotonicNs();
   kill_main = false;
   long int raw_port;
 
-  if( signal(SIGINT, sigintHandler) == SIG_ERR)
+  loadDefaultKeymap(&cec_key_table);
+
+  if ((signal(SIGINT, sigintHandler) == SIG_ERR) ||
+      (signal(SIGHUP, sighupHandler) == SIG_ERR))
   {
     std::cerr << "Could not install signal handler" << std::endl;
     return -1;
   }
 
+  enum
+  {
+    OPT_RECORD = 256,
+    OPT_REPLAY,
+    OPT_REPLAY_SPEED,
+    OPT_SIMULATE
+  };
+
+  static const struct option long_options[] =
+  {
+    {"record",       required_argument, NULL, OPT_RECORD},
+    {"replay",       required_argument, NULL, OPT_REPLAY},
+    {"replay-speed", required_argument, NULL, OPT_REPLAY_SPEED},
+    {"simulate",     no_argument,       NULL, OPT_SIMULATE},
+    {NULL,           0,                 NULL, 0}
+  };
+
   std::string cec_device_name, ui_device_name;
   int opt_return;
   bool dump_and_exit = false;
-  while ((opt_return = getopt(argc, argv, "c:d:u:p:n:mh?")) != -1)
+  while ((opt_return = getopt_long(argc, argv, "c:d:u:p:n:t:mh?",
+                                   long_options, NULL)) != -1)
   {
     switch (opt_return)
     {
       case 'c':
+        configFile = optarg;
         read_config_yaml(optarg);
         break;
 
@@ -116,6 +356,42 @@ int main(int argc, char* argv[])
           cecDeviceName = optarg;
         }
         break;
+      case 't':
+        char *threads_remain;
+        long int raw_threads;
+        errno = 0;
+        raw_threads = strtol(optarg, &threads_remain, 10);
+
+        if ((errno != 0) || (*threads_remain != '\0') || (raw_threads < 1)
+                                                    || (raw_threads > 64))
+        {
+          std::cout << "invalid websocket thread count provided:"
+                    << optarg << std::endl;
+          return -1;
+        }
+        wsThreads = raw_threads;
+        break;
+      case OPT_RECORD:
+        recordFile = optarg;
+        break;
+      case OPT_REPLAY:
+        replayFile = optarg;
+        break;
+      case OPT_REPLAY_SPEED:
+        char *speed_remain;
+        errno = 0;
+        replaySpeed = strtod(optarg, &speed_remain);
+
+        if ((errno != 0) || (*speed_remain != '\0') || (replaySpeed < 0))
+        {
+          std::cout << "invalid replay speed provided:" << optarg
+                    << std::endl;
+          return -1;
+        }
+        break;
+      case OPT_SIMULATE:
+        cecSimulate = true;
+        break;
       case 'h':
       case '?':
       default:
@@ -135,422 +411,2179 @@ int main(int argc, char* argv[])
     ui_device_name = "/dev/uinput";
   }
 
-  //create input device
-  UserInputDevice::InputDevice* id;
+  // without an adapters list in the config file there is a single adapter,
+  // set up from the command line
+  if (adapters.empty())
+  {
+    AdapterContext* context = new AdapterContext();
+    context->id = "default";
+    context->input_name = "ui_device";
+    context->key_table = cec_key_table;
+    adapters.push_back(context);
+  }
+
+  if (adapters.size() == 1)
+  {
+    if (adapters[0]->cec_device_name.empty())
+    {
+      adapters[0]->cec_device_name = cec_device_name;
+    }
+  }
+
+  for (size_t i = 0; i < adapters.size(); i++)
+  {
+    if (adapters[i]->ui_device_name.empty())
+    {
+      adapters[i]->ui_device_name = ui_device_name;
+    }
+
+    if (adapters[i]->osd_name.empty())
+    {
+      adapters[i]->osd_name = cecDeviceName;
+    }
+  }
 
+  // from here on messages go through the logger's ring, so the threads
+  // handling keys never wait for stdout or the journal
+  Logger::Logger* logger = NULL;
   try
   {
-    id = new UserInputDevice::InputDevice(ui_device_name);
+    logger = new Logger::Logger(logLevel, logOutput);
+    Logger::install(logger);
   }
-  catch(UserInputDevice::InputDeviceException& e)
+  catch(Logger::LoggerException& e)
   {
-    std::cerr << "Can't open user input device: " << e.what() << std::endl;
+    std::cerr << "Can't start logging: " << e.what() << std::endl;
     return -1;
   }
 
-  CEC::ICECCallbacks cec_callbacks;
-  CEC::libcec_configuration cec_config;
-  cec_config.Clear();
-  cec_callbacks.Clear();
-
-  strcpy(cec_config.strDeviceName, cecDeviceName.c_str());
-  cec_config.clientVersion         = CEC::LIBCEC_VERSION_CURRENT;
-  cec_config.bActivateSource       = 0;
-  cec_config.iButtonRepeatRateMs   = cecRepeatRateMs;
-  cec_config.iButtonReleaseDelayMs = cecReleaseDelayMs;
-  cec_config.iDoubleTapTimeoutMs   = cecDoubleTapTimeoutMs;
-  cec_callbacks.keyPress           = &cecKeyPressCB;
-  cec_config.callbacks             = &cec_callbacks;
-  cec_config.deviceTypes.Add(CEC::CEC_DEVICE_TYPE_RECORDING_DEVICE);
+  Recorder::Player* player = NULL;
+  try
+  {
+    if (!recordFile.empty())
+    {
+      recorder = new Recorder::Recorder(recordFile);
+    }
 
-  cec_adapter = LibCecInitialise(&cec_config);
-  if(!cec_adapter)
+    if (!replayFile.empty())
+    {
+      player = new Recorder::Player(replayFile);
+    }
+  }
+  catch(Recorder::RecorderException& e)
   {
-    std::cerr << "Cannot load libcec.so" << std::endl;
-    delete id;
+    Logger::log(Logger::LEVEL_ERROR, "Can't open recording: %s", e.what());
+    delete recorder;
+    delete logger;
     return -1;
   }
 
-  if (cec_device_name.empty())
-  {
+  key_scheduler = new Scheduler::Scheduler();
 
-    std::cout << "Attempting cec device autodetect..."
-              << std::endl;
-    std::array<CEC::cec_adapter_descriptor,10> cec_devices;
-    int8_t devices_found =
-      cec_adapter->DetectAdapters(cec_devices.data(), 10, NULL, true);
+  // libcec and the websocket server are brought up on their own threads
+  // while this one sets up the input devices. Keys that arrive before a
+  // device is ready wait in its key queue.
+  for (size_t i = 0; (i < adapters.size()) && !startup_failed; i++)
+  {
+    AdapterContext* context = adapters[i];
 
-    if( devices_found < 1)
+    try
     {
-      std::cerr << "CEC device autodetection failed" << std::endl;
-      UnloadLibCec(cec_adapter);
-      delete id;
-      return -1;
+      context->key_pipeline = new KeyPipeline::KeyPipeline(NULL, keyQueueSize,
+                                                           keyQueueOverflow,
+                                                           cecKernelRepeat);
     }
+    catch(KeyQueue::KeyQueueException& e)
+    {
+      Logger::log(Logger::LEVEL_ERROR, "Can't create key queue: %s",
+                  e.what());
+      startup_failed = true;
+      break;
+    }
+
+    context->key_pipeline->setKeyTable(context->key_table);
+    context->key_pipeline->setCECKeyObserver(
+      [context](const CEC::cec_keypress& msg,
+                const KeyTable::KeyTable& key_table)
+      {
+        publishKeyEvent(context, msg, key_table);
+      });
+    context->key_pipeline->setCECMacroHandler(
+      [context](const KeyTable::Macro& macro)
+      {
+        playCECMacro(context, macro);
+      });
 
-    cec_device_name = cec_devices[0].strComName;
+    context->macro_runner = new MacroRunner::MacroRunner(
+      context->key_pipeline, key_scheduler);
   }
 
-  if(!cec_adapter->Open(cec_device_name.c_str()))
+  // the signal handlers stop every key pipeline from here on
+  adapters_ready = true;
+
+  if (startup_failed)
   {
-    std::cerr << "Unable to open CEC device on port: " << cec_device_name
-              << std::endl;
-    delete id;
-    UnloadLibCec(cec_adapter);
-    return -1;
+    kill_main = true;
   }
+  else
+  {
+    config_reloader = new ConfigReloader::ConfigReloader(&reloadKeymap);
 
-  std::cout << "CEC device connected" << std::endl;
-
+    // a replay stands in for the TV, so libcec isn't loaded
+    for (size_t i = 0; (i < adapters.size()) && (!player || cecSimulate);
+         i++)
+    {
+      adapters[i]->cec_thread = std::thread(&connectCEC, adapters[i]);
+    }
+  }
 
   pthread_t ws_thread;
+  bool ws_started = false;
 
-  if (ws_port > 0)
+  if ((ws_port > 0) && !kill_main)
   {
     if (pthread_create(&ws_thread, NULL, ws_loop, NULL))
     {
-      std::cout << "Unable to start websocket thread" << std::endl;
-      kill_main = true;
+      Logger::log(Logger::LEVEL_ERROR, "Unable to start websocket thread");
+      stopStartup();
     }
-  }
-
-  while (!kill_main)
-  {
+    else
     {
-      std::lock_guard<std::mutex> lock(key_mutex);
-
-      if (!key_queue.empty())
-      {
-        int input_key = key_queue.front();
-        key_queue.pop();
-        id->sendKeyInput(input_key);
-      }
+      ws_started = true;
     }
-
-    usleep(5000);
   }
 
-  ws_server.stop();
-  cec_adapter->Close();
-  delete id;
-  UnloadLibCec(cec_adapter);
-  pthread_join(ws_thread, NULL);
-  return 0;
-}
-
-
-void* ws_loop(void*)
-{
-  try
+  //create input devices
+  for (size_t i = 0; (i < adapters.size()) && !kill_main; i++)
   {
-    ws_server.set_access_channels(websocketpp::log::alevel::fail);
-    ws_server.clear_access_channels(websocketpp::log::alevel::fail);
-    ws_server.init_asio();
-    ws_server.set_message_handler(
-      websocketpp::lib::bind(&wsMessageCB, &ws_server,
-                             websocketpp::lib::placeholders::_1,
-                             websocketpp::lib::placeholders::_2));
-    ws_server.listen(ws_port);
-    ws_server.start_accept();
+    AdapterContext* context = adapters[i];
+    uint64_t uinput_ns = Stats::monotonicNs();
 
-    std::cout << "Websocket available on port " << ws_port << std::endl;
-    ws_server.run();
+    try
+    {
+      context->input_device = new UserInputDevice::InputDevice(
+        context->ui_device_name, cecKernelRepeat, context->input_name);
+      context->key_pipeline->setDevice(context->input_device);
+      logStartupTime("input device", uinput_ns);
+    }
+    catch(UserInputDevice::InputDeviceException& e)
+    {
+      Logger::log(Logger::LEVEL_ERROR,
+                  "Can't open user input device for adapter '%s': %s",
+                  context->id.c_str(), e.what());
+      stopStartup();
+    }
   }
-  catch (websocketpp::exception const & e)
+
+  std::thread replay_thread;
+  if (player && !kill_main)
   {
-    std::cout << e.what() << std::endl;
-    kill_main = true;
+    replay_thread = std::thread(&replayLog, player);
   }
 
-  pthread_exit(NULL);
-}
-
-
-void read_config_yaml(std::string config_file)
-{
-  YAML::Node config;
-  try
+  // each adapter's keys are sent by its own thread, this one waits for
+  // them all to be stopped
+  for (size_t i = 0; (i < adapters.size()) && !kill_main; i++)
   {
-    config = YAML::LoadFile(config_file);
+    adapters[i]->dispatch_thread =
+      std::thread(&KeyPipeline::KeyPipeline::run, adapters[i]->key_pipeline);
   }
-  catch (YAML::BadFile)
+
+  for (size_t i = 0; i < adapters.size(); i++)
   {
-    std::cerr << "'" << config_file << "'" << " was not found." << std::endl
-              << "exiting." << std::endl;
-    exit(1);
+    if (adapters[i]->dispatch_thread.joinable())
+    {
+      adapters[i]->dispatch_thread.join();
+    }
   }
 
-  if (config["RepeatRateMs"])
+  if (player)
   {
-    cecRepeatRateMs = config["RepeatRateMs"].as<int>();
+    player->stop();
+    if (replay_thread.joinable())
+    {
+      replay_thread.join();
+    }
   }
 
-  if (config["ReleaseDelayMs"])
+  for (size_t i = 0; i < adapters.size(); i++)
   {
-    cecReleaseDelayMs = config["ReleaseDelayMs"].as<int>();
+    KeyPipeline::KeyPipeline* pipeline = adapters[i]->key_pipeline;
+    if (!pipeline)
+    {
+      continue;
+    }
+
+    const Stats::PipelineStats& pipeline_stats = pipeline->stats();
+    Logger::log(Logger::LEVEL_INFO,
+                "Dispatcher for adapter '%s' woke %llu times for %llu keys, "
+                "%llu keys dropped", adapters[i]->id.c_str(),
+                (unsigned long long) pipeline_stats.wakeups,
+                (unsigned long long) (pipeline_stats.cec_keys +
+                                      pipeline_stats.ws_keys),
+                (unsigned long long) pipeline->queue().overflows());
   }
 
-  if (config["DoubleTapTimeoutMs"])
+  ws_server.stop();
+  if (ws_started)
   {
-    cecDoubleTapTimeoutMs = config["DoubleTapTimeoutMs"].as<int>();
+    pthread_join(ws_thread, NULL);
   }
 
-  if (config["keymap"])
+  for (size_t i = 0; i < adapters.size(); i++)
   {
-    cec_to_key.clear();
-    const YAML::Node keymap = config["keymap"];
+    AdapterContext* context = adapters[i];
 
-    for (YAML::const_iterator it = keymap.begin(); it != keymap.end(); it++)
+    // an adapter scan can't be interrupted, shutdown waits for it to finish
+    if (context->cec_thread.joinable())
     {
-      std::string key = it->first.as<std::string>();
-      std::string value = it->second.as<std::string>();
-
-      CEC::cec_user_control_code control_code;
-      int input_key;
+      context->cec_thread.join();
+    }
 
-      if (! (getCECControlCode(key, &control_code) &&
-             getInputKeyCode(value, &input_key)) )
-      {
-        std::cerr << "'" << config_file
-                  << "' contains the following invalid keymap pair:"
-                  << std::endl << "\t\"" << key << ": " << value << "\""
-                  << std::endl << "exiting." << std::endl;
-        exit(1);
-      }
+    CECCache::CECCache* cache = context->cec_cache;
+    if (cache)
+    {
+      cache->stop();
+    }
 
-      cec_to_key[control_code] = input_key;
+    delete context->cec_executor.load();
+    if (context->cec_adapter)
+    {
+      context->cec_adapter->Close();
     }
+
+    context->cec_cache = NULL;
+    delete cache;
   }
-  else
+
+  ConfigReloader::ConfigReloader* reloader = config_reloader;
+  config_reloader = NULL;
+  delete reloader;
+
+  // macros still playing are abandoned
+  delete key_scheduler;
+  delete event_stream.load();
+  delete rate_limiter.load();
+
+  for (size_t i = 0; i < adapters.size(); i++)
   {
-    std::cerr << "keymap was not found in '" << config_file << ". "
-              << "using defaults instead." << std::endl;
+    AdapterContext* context = adapters[i];
+    delete context->macro_runner;
+    delete context->input_device;
+    delete context->cec_adapter;
+    delete context->key_pipeline;
+    delete context;
+  }
+  delete player;
+
+  if (recorder)
+  {
+    Logger::log(Logger::LEVEL_INFO, "Recorded %llu inputs to '%s'",
+                (unsigned long long) recorder->records(),
+                recordFile.c_str());
+    delete recorder;
   }
+
+  // every other thread has stopped, so nothing is still logging
+  delete logger;
+  return startup_failed ? -1 : 0;
 }
 
 
-void cecKeyPressCB(void*, const CEC::cec_keypress* msg)
+void connectCEC(AdapterContext* context)
 {
-  int input_key;
-  if (translateCECToKeyCode(msg->keycode, &input_key))
+  uint64_t phase_ns = Stats::monotonicNs();
+  CEC::libcec_configuration& cec_config = context->cec_config;
+  CEC::ICECCallbacks& cec_callbacks = context->cec_callbacks;
+
+  cec_config.Clear();
+  cec_callbacks.Clear();
+
+  strcpy(cec_config.strDeviceName, context->osd_name.c_str());
+  cec_config.clientVersion         = CEC::LIBCEC_VERSION_CURRENT;
+  cec_config.bActivateSource       = 0;
+  // with kernel repeat libcec reports only the press and the release, and
+  // the input subsystem generates the repeats while the key is held
+  cec_config.iButtonRepeatRateMs   = cecKernelRepeat ? 0 : cecRepeatRateMs;
+  cec_config.iButtonReleaseDelayMs = cecReleaseDelayMs;
+  cec_config.iDoubleTapTimeoutMs   = cecDoubleTapTimeoutMs;
+  cec_callbacks.keyPress           = &cecKeyPressCB;
+  cec_callbacks.commandReceived    = &cecCommandCB;
+  cec_callbacks.sourceActivated    = &cecSourceActivatedCB;
+  cec_config.callbacks             = &cec_callbacks;
+  cec_config.callbackParam         = context;
+  cec_config.deviceTypes.Add(CEC::CEC_DEVICE_TYPE_RECORDING_DEVICE);
+
+  CECAdapter::CECAdapter* adapter;
+
+  if (cecSimulate)
   {
-    std::lock_guard<std::mutex> lock(key_mutex);
-    key_queue.push(input_key);
+    adapter = new CECSimulator::CECSimulator(cec_config, simSettings);
+    context->cec_adapter = adapter;
+    Logger::log(Logger::LEVEL_INFO, "Adapter '%s' uses a simulated CEC bus",
+                context->id.c_str());
   }
   else
   {
-    std::cout << "Unmapped CEC code received: "
-              << getCECControlStr(msg->keycode) << std::endl;
+    adapter = openLibCEC(context, phase_ns);
+    if (!adapter)
+    {
+      stopStartup();
+      return;
+    }
   }
+
+  context->cec_executor = new CECExecutor::CECExecutor(adapter);
+  context->cec_cache = new CECCache::CECCache(adapter, cacheTtlMs);
+
+  Logger::log(Logger::LEVEL_INFO, "CEC device connected for adapter '%s'",
+              context->id.c_str());
+  logStartupTime("ready", startup_ns);
 }
 
 
-bool execCECCommand(std::string cmd, std::string args, std::string* response)
+// returns NULL if no adapter could be opened
+CECAdapter::CECAdapter* openLibCEC(AdapterContext* context,
+                                   uint64_t phase_ns)
 {
-  if (cmd.compare("transmit") == 0)
+  std::string cec_device_name = context->cec_device_name;
+  CEC::ICECAdapter* libcec = LibCecInitialise(&context->cec_config);
+  if(!libcec)
   {
-    CEC::cec_command bytes = cec_adapter->CommandFromString(args.c_str());
-    bytes.transmit_timeout = 0;
-    if (cec_adapter->Transmit(bytes))
-    {
-      *response = "Bytes sent (Warning: This function has not been tested)";
-    }
-    else
-    {
-      *response = "Byte transmission failed";
-    }
+    Logger::log(Logger::LEVEL_ERROR, "Cannot load libcec.so");
+    return NULL;
   }
-  else if (cmd.compare("on") == 0)
+
+  logStartupTime("libcec load", phase_ns);
+
+  // set before the adapter is opened, libcec reports the bus from then on
+  CECAdapter::CECAdapter* adapter = new CECAdapter::LibCECAdapter(libcec);
+  context->cec_adapter = adapter;
+
+  bool opened = false;
+
+  if (cec_device_name.empty())
   {
-    int addr = -1;
-    if (sscanf(args.c_str(), "%x", &addr) == 1)
+    // the adapter found by the last scan is tried first, a full scan is
+    // only needed when it has gone
+    std::string cached_device_name = readCachedAdapter();
+
+    if (!cached_device_name.empty() &&
+        ((cached_device_name[0] != '/') ||
+         (access(cached_device_name.c_str(), F_OK) == 0)))
     {
-      if ((addr >= 0) && (addr < 256))
+      phase_ns = Stats::monotonicNs();
+      opened = libcec->Open(cached_device_name.c_str());
+
+      if (opened)
       {
-        if(cec_adapter->PowerOnDevices((CEC::cec_logical_address) addr))
-        {
-          *response = "Device powered on";
-          return true;
-        }
+        cec_device_name = cached_device_name;
+        logStartupTime("cached cec device open", phase_ns);
       }
-    }
-
-    *response = "Failed to power device";
-    return false;
-  }
-  else if (cmd.compare("standby") == 0)
-  {
-    int addr = -1;
-    if (sscanf(args.c_str(), "%x", &addr) == 1)
-    {
-      if ((addr >= 0) && (addr < 256))
+      else
       {
-        if(cec_adapter->StandbyDevices((CEC::cec_logical_address) addr))
-        {
-          *response = "Device set to standby";
-          return true;
-        }
+        Logger::log(Logger::LEVEL_WARNING,
+                    "Cached cec device %s could not be opened",
+                    cached_device_name.c_str());
       }
     }
 
-    *response = "Failed to put device in standby";
-    return false;
-  }
-  else if (cmd.compare("set_addr_active") == 0)
-  {
-    int addr = -1;
-    if (sscanf(args.c_str(), "%x", &addr) == 1)
+    if (!opened)
     {
-      std::cout << "addr: " << addr << std::endl;
-      if ((addr >= 0) && (addr < CEC_INVALID_PHYSICAL_ADDRESS))
+      Logger::log(Logger::LEVEL_INFO, "Attempting cec device autodetect...");
+      phase_ns = Stats::monotonicNs();
+      std::array<CEC::cec_adapter_descriptor,10> cec_devices;
+      int8_t devices_found =
+        libcec->DetectAdapters(cec_devices.data(), 10, NULL, true);
+
+      if( devices_found < 1)
       {
-        cec_adapter->SetStreamPath((uint16_t) addr);
-        *response = "Active path set";
-        return true;
+        Logger::log(Logger::LEVEL_ERROR, "CEC device autodetection failed");
+        context->cec_adapter = NULL;
+        delete adapter;
+        return NULL;
       }
-    }
 
-    *response = "Failed to set active path";
-    return false;
+      cec_device_name = cec_devices[0].strComName;
+      logStartupTime("cec device autodetect", phase_ns);
+      writeCachedAdapter(cec_device_name);
+    }
   }
-  else if (cmd.compare("activate") == 0)
+
+  if (!opened)
   {
-    if (cec_adapter->SetActiveSource())
-    {
-      *response = "Device set as active source";
-    }
-    else
+    phase_ns = Stats::monotonicNs();
+
+    if(!libcec->Open(cec_device_name.c_str()))
     {
-      *response = "Failed to set device as active source";
+      Logger::log(Logger::LEVEL_ERROR, "Unable to open CEC device on port: %s",
+                  cec_device_name.c_str());
+      context->cec_adapter = NULL;
+      delete adapter;
+      return NULL;
     }
+
+    logStartupTime("cec device open", phase_ns);
   }
-  else if (cmd.compare("deactivate") == 0)
+
+  return adapter;
+}
+
+
+std::string readCachedAdapter(void)
+{
+  std::string cec_device_name;
+
+  if (!adapterCacheFile.empty())
+  {
+    std::ifstream cache(adapterCacheFile.c_str());
+    std::getline(cache, cec_device_name);
+  }
+
+  return cec_device_name;
+}
+
+
+void writeCachedAdapter(const std::string& cec_device_name)
+{
+  if (adapterCacheFile.empty())
+  {
+    return;
+  }
+
+  std::ofstream cache(adapterCacheFile.c_str(), std::ios::trunc);
+  cache << cec_device_name << std::endl;
+
+  if (!cache)
+  {
+    Logger::log(Logger::LEVEL_WARNING,
+                "Unable to write the cec device cache '%s'",
+                adapterCacheFile.c_str());
+  }
+}
+
+
+void logStartupTime(const std::string& phase, uint64_t phase_start_ns)
+{
+  uint64_t now_ns = Stats::monotonicNs();
+  Logger::log(Logger::LEVEL_INFO,
+              "Startup: %s took %llu ms (%llu ms since start)", phase.c_str(),
+              (unsigned long long) ((now_ns - phase_start_ns) / 1000000),
+              (unsigned long long) ((now_ns - startup_ns) / 1000000));
+}
+
+
+void stopStartup(void)
+{
+  startup_failed = true;
+  kill_main = true;
+  stopDispatch();
+}
+
+
+// stops every adapter's dispatch thread, safe to call from a signal
+// handler
+void stopDispatch(void)
+{
+  if (!adapters_ready)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < adapters.size(); i++)
+  {
+    if (adapters[i]->key_pipeline)
+    {
+      adapters[i]->key_pipeline->stop();
+    }
+  }
+}
+
+
+void cecKeyPressCB(void* cbparam, const CEC::cec_keypress* msg)
+{
+  AdapterContext* context = static_cast<AdapterContext*>(cbparam);
+
+  if (recorder)
+  {
+    recorder->keyPress(context->index, *msg, Stats::monotonicNs());
+  }
+
+  KeyPipeline::KeyPipeline::cecKeyPressCB(context->key_pipeline, msg);
+}
+
+
+void replayLog(Recorder::Player* player)
+{
+  uint64_t start_ns = Stats::monotonicNs();
+
+  // replayed websocket messages come from no connection, so their
+  // responses are dropped. Input for an adapter that isn't configured is
+  // skipped.
+  bool complete = player->play(replaySpeed,
+    [](uint8_t adapter, const CEC::cec_keypress& key)
+    {
+      if (adapter < adapters.size())
+      {
+        KeyPipeline::KeyPipeline::cecKeyPressCB(
+          adapters[adapter]->key_pipeline, &key);
+      }
+    },
+    [](uint8_t adapter, bool binary, const std::string& payload)
+    {
+      if (adapter < adapters.size())
+      {
+        handleMessage(payload, binary, Stats::monotonicNs(),
+                      websocketpp::connection_hdl(), adapters[adapter],
+                      [](const void*, size_t,
+                         websocketpp::frame::opcode::value)
+                      {
+                      });
+      }
+    });
+
+  if (!complete)
+  {
+    Logger::log(Logger::LEVEL_ERROR, "'%s' is truncated or corrupt",
+                replayFile.c_str());
+  }
+
+  Logger::log(Logger::LEVEL_INFO, "Replayed %llu inputs in %llu ms",
+              (unsigned long long) player->played(),
+              (unsigned long long) ((Stats::monotonicNs() - start_ns) /
+                                    1000000));
+
+  // macros still playing and the keys still queued are sent before the
+  // daemon exits
+  size_t busy = 1;
+  while (!kill_main && (busy > 0))
+  {
+    busy = key_scheduler->pending();
+    for (size_t i = 0; i < adapters.size(); i++)
+    {
+      busy += adapters[i]->key_pipeline->queue().size();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  kill_main = true;
+  stopDispatch();
+}
+
+
+void* ws_loop(void*)
+{
+  try
+  {
+    ws_server.set_access_channels(websocketpp::log::alevel::fail);
+    ws_server.clear_access_channels(websocketpp::log::alevel::fail);
+    ws_server.init_asio();
+    event_stream = new EventStream::EventStream(&ws_server, eventBufferBytes);
+    rate_limiter = new RateLimiter::RateLimiter(rateLimits);
+    ws_server.set_validate_handler(
+      websocketpp::lib::bind(&wsValidateCB, &ws_server,
+                             websocketpp::lib::placeholders::_1));
+    ws_server.set_open_handler(&wsOpenCB);
+    ws_server.set_close_handler(&wsCloseCB);
+    ws_server.set_http_handler(
+      websocketpp::lib::bind(&wsHttpCB, &ws_server,
+                             websocketpp::lib::placeholders::_1));
+    ws_server.set_message_handler(
+      websocketpp::lib::bind(&wsMessageCB, &ws_server,
+                             websocketpp::lib::placeholders::_1,
+                             websocketpp::lib::placeholders::_2));
+    ws_server.listen(ws_port);
+    ws_server.start_accept();
+
+    Logger::log(Logger::LEVEL_INFO,
+                "Websocket available on port %d using %u thread(s)",
+                ws_port, wsThreads);
+
+    // every thread runs the same io_service. websocketpp runs each
+    // connection's handlers through its own strand, so messages from one
+    // client are still handled one at a time and in order.
+    std::vector<std::thread> ws_workers;
+    for (uint32_t i = 1; i < wsThreads; i++)
+    {
+      ws_workers.push_back(std::thread([]()
+      {
+        try
+        {
+          ws_server.run();
+        }
+        catch (websocketpp::exception const & e)
+        {
+          Logger::log(Logger::LEVEL_ERROR, "%s", e.what());
+        }
+      }));
+    }
+
+    ws_server.run();
+
+    for (size_t i = 0; i < ws_workers.size(); i++)
+    {
+      ws_workers[i].join();
+    }
+  }
+  catch (websocketpp::exception const & e)
+  {
+    Logger::log(Logger::LEVEL_ERROR, "%s", e.what());
+    kill_main = true;
+    stopDispatch();
+  }
+
+  pthread_exit(NULL);
+}
+
+
+void read_config_yaml(std::string config_file)
+{
+  YAML::Node config;
+  try
+  {
+    config = YAML::LoadFile(config_file);
+  }
+  catch (YAML::BadFile)
+  {
+    std::cerr << "'" << config_file << "'" << " was not found." << std::endl
+              << "exiting." << std::endl;
+    exit(1);
+  }
+
+  if (config["RepeatRateMs"])
+  {
+    cecRepeatRateMs = config["RepeatRateMs"].as<int>();
+  }
+
+  if (config["ReleaseDelayMs"])
+  {
+    cecReleaseDelayMs = config["ReleaseDelayMs"].as<int>();
+  }
+
+  if (config["DoubleTapTimeoutMs"])
+  {
+    cecDoubleTapTimeoutMs = config["DoubleTapTimeoutMs"].as<int>();
+  }
+
+  if (config["KernelRepeat"])
+  {
+    cecKernelRepeat = config["KernelRepeat"].as<bool>();
+  }
+
+  if (config["WebsocketThreads"])
+  {
+    wsThreads = config["WebsocketThreads"].as<int>();
+
+    if ((wsThreads < 1) || (wsThreads > 64))
+    {
+      std::cerr << "'" << config_file << "' contains an invalid "
+                << "WebsocketThreads value, it must be between 1 and 64"
+                << std::endl << "exiting." << std::endl;
+      exit(1);
+    }
+  }
+
+  if (config["EventBufferBytes"])
+  {
+    eventBufferBytes = config["EventBufferBytes"].as<int>();
+  }
+
+  if (config["MacroDelayMs"])
+  {
+    macroDelayMs = config["MacroDelayMs"].as<int>();
+  }
+
+  if (config["KeyRateLimit"])
+  {
+    rateLimits[RateLimiter::TARGET_KEY].rate =
+      config["KeyRateLimit"].as<double>();
+  }
+
+  if (config["KeyRateBurst"])
+  {
+    rateLimits[RateLimiter::TARGET_KEY].burst =
+      config["KeyRateBurst"].as<double>();
+  }
+
+  if (config["MaxQueuedKeys"])
+  {
+    rateLimits[RateLimiter::TARGET_KEY].max_queued =
+      config["MaxQueuedKeys"].as<int>();
+  }
+
+  if (config["CecRateLimit"])
+  {
+    rateLimits[RateLimiter::TARGET_CEC].rate =
+      config["CecRateLimit"].as<double>();
+  }
+
+  if (config["CecRateBurst"])
+  {
+    rateLimits[RateLimiter::TARGET_CEC].burst =
+      config["CecRateBurst"].as<double>();
+  }
+
+  if (config["MaxQueuedCec"])
+  {
+    rateLimits[RateLimiter::TARGET_CEC].max_queued =
+      config["MaxQueuedCec"].as<int>();
+  }
+
+  if (config["LogLevel"])
+  {
+    if (!Logger::parseLevel(config["LogLevel"].as<std::string>(), &logLevel))
+    {
+      std::cerr << "'" << config_file << "' contains an invalid LogLevel, "
+                << "expected error, warning, info or debug" << std::endl
+                << "exiting." << std::endl;
+      exit(1);
+    }
+  }
+
+  if (config["LogOutput"])
+  {
+    if (!Logger::parseOutput(config["LogOutput"].as<std::string>(),
+                             &logOutput))
+    {
+      std::cerr << "'" << config_file << "' contains an invalid LogOutput, "
+                << "expected console or syslog" << std::endl
+                << "exiting." << std::endl;
+      exit(1);
+    }
+  }
+
+  if (config["CacheTtlMs"])
+  {
+    cacheTtlMs = config["CacheTtlMs"].as<int>();
+  }
+
+  if (config["SimKeyRate"])
+  {
+    simSettings.key_rate = config["SimKeyRate"].as<double>();
+  }
+
+  if (config["SimLatencyMs"])
+  {
+    simSettings.latency_ms = config["SimLatencyMs"].as<int>();
+  }
+
+  if (config["SimFailureRate"])
+  {
+    simSettings.failure_rate = config["SimFailureRate"].as<double>();
+
+    if ((simSettings.failure_rate < 0) || (simSettings.failure_rate > 1))
+    {
+      std::cerr << "'" << config_file << "' contains an invalid "
+                << "SimFailureRate value, it must be between 0 and 1"
+                << std::endl << "exiting." << std::endl;
+      exit(1);
+    }
+  }
+
+  if (config["AdapterCacheFile"])
+  {
+    adapterCacheFile = config["AdapterCacheFile"].as<std::string>();
+  }
+
+  if (config["QueueSize"])
+  {
+    keyQueueSize = config["QueueSize"].as<int>();
+  }
+
+  if (config["QueueOverflow"])
+  {
+    std::string policy = config["QueueOverflow"].as<std::string>();
+
+    if (policy.compare("drop") == 0)
+    {
+      keyQueueOverflow = KeyQueue::DROP_NEWEST;
+    }
+    else if (policy.compare("block") == 0)
+    {
+      keyQueueOverflow = KeyQueue::BLOCK;
+    }
+    else
+    {
+      std::cerr << "'" << config_file << "' contains an invalid QueueOverflow"
+                << " value: \"" << policy << "\" (expected drop or block)"
+                << std::endl << "exiting." << std::endl;
+      exit(1);
+    }
+  }
+
+  std::string error;
+  if (!parseKeymap(config, &cec_key_table, &error))
+  {
+    std::cerr << "'" << config_file << "' contains " << error << std::endl
+              << "exiting." << std::endl;
+    exit(1);
+  }
+
+  if (!config["keymap"])
+  {
+    std::cerr << "keymap was not found in '" << config_file << ". "
+              << "using defaults instead." << std::endl;
+  }
+
+  const YAML::Node adapters_config = config["adapters"];
+  for (size_t i = 0; i < adapters_config.size(); i++)
+  {
+    const YAML::Node adapter_config = adapters_config[i];
+    AdapterContext* context = new AdapterContext();
+    context->index = i;
+
+    if (adapter_config["id"])
+    {
+      context->id = adapter_config["id"].as<std::string>();
+    }
+
+    if (adapter_config["device"])
+    {
+      context->cec_device_name = adapter_config["device"].as<std::string>();
+    }
+
+    if (adapter_config["uinput"])
+    {
+      context->ui_device_name = adapter_config["uinput"].as<std::string>();
+    }
+
+    if (adapter_config["name"])
+    {
+      context->osd_name = adapter_config["name"].as<std::string>();
+    }
+
+    context->input_name = "ui_device " + context->id;
+
+    if (context->id.empty() || findAdapter(context->id) ||
+        (i >= 256) || (context->osd_name.size() > 13))
+    {
+      std::cerr << "'" << config_file << "' contains an invalid adapter, "
+                << "each needs a unique id and a name of at most 13 "
+                << "characters" << std::endl << "exiting." << std::endl;
+      exit(1);
+    }
+
+    // only one adapter can be found by autodetection
+    if ((adapters_config.size() > 1) && context->cec_device_name.empty())
+    {
+      std::cerr << "'" << config_file << "' lists more than one adapter, "
+                << "so each needs a device" << std::endl
+                << "exiting." << std::endl;
+      exit(1);
+    }
+
+    if (!parseAdapterKeymap(config, context->id, &context->key_table,
+                            &error))
+    {
+      std::cerr << "'" << config_file << "' contains " << error
+                << " for adapter '" << context->id << "'" << std::endl
+                << "exiting." << std::endl;
+      exit(1);
+    }
+
+    adapters.push_back(context);
+  }
+}
+
+
+void loadDefaultKeymap(KeyTable::KeyTable* key_table)
+{
+  for (size_t i = 0;
+       i < sizeof(default_cec_to_key) / sizeof(default_cec_to_key[0]); i++)
+  {
+    key_table->set(default_cec_to_key[i].cec_control_code,
+                   default_cec_to_key[i].input_key);
+  }
+}
+
+
+bool parseKeymap(const YAML::Node& config, KeyTable::KeyTable* key_table,
+                 std::string* error)
+{
+  key_table->clear();
+
+  if (!config["keymap"])
+  {
+    loadDefaultKeymap(key_table);
+  }
+
+  if (config["macros"])
+  {
+    const YAML::Node macros = config["macros"];
+
+    for (YAML::const_iterator it = macros.begin(); it != macros.end(); it++)
+    {
+      KeyTable::Macro macro;
+      macro.name = it->first.as<std::string>();
+      std::shared_ptr<KeyTable::Sequence> sequence =
+        std::make_shared<KeyTable::Sequence>();
+
+      for (YAML::const_iterator step_it = it->second.begin();
+           step_it != it->second.end(); step_it++)
+      {
+        std::string step_text = step_it->as<std::string>();
+        KeyTable::Step step;
+
+        if (!MacroRunner::parseStep(step_text, macroDelayMs, &step))
+        {
+          *error = "an invalid step in macro \"" + macro.name + "\":\n\t\"" +
+                   step_text + "\"";
+          return false;
+        }
+
+        sequence->push_back(step);
+      }
+
+      if (sequence->empty() || (macro.name.compare("sequence") == 0) ||
+          (MacroRunner::keyCount(*sequence) > keyQueueSize))
+      {
+        *error = "an invalid macro: \"" + macro.name + "\"";
+        return false;
+      }
+
+      macro.sequence = sequence;
+      key_table->addMacro(macro);
+    }
+  }
+
+  if (config["keymap"])
+  {
+    const YAML::Node keymap = config["keymap"];
+
+    for (YAML::const_iterator it = keymap.begin(); it != keymap.end(); it++)
+    {
+      std::string key = it->first.as<std::string>();
+      std::string value = it->second.as<std::string>();
+
+      CEC::cec_user_control_code control_code;
+      UserInputDevice::Chord chord;
+
+      // "macro:name" plays a macro from the macros section instead of
+      // sending a key
+      if ((value.compare(0, 6, "macro:") == 0) &&
+          getCECControlCode(key, &control_code))
+      {
+        int macro = key_table->findMacro(value.substr(6));
+        if (macro >= 0)
+        {
+          key_table->setMacro(control_code, macro);
+          continue;
+        }
+      }
+
+      if (! (getCECControlCode(key, &control_code) &&
+             getInputChord(value, &chord)) )
+      {
+        *error = "the following invalid keymap pair:\n\t\"" + key + ": " +
+                 value + "\"";
+        return false;
+      }
+
+      key_table->set(control_code, chord);
+    }
+  }
+
+  return true;
+}
+
+
+// an adapter with a keymap or macros of its own uses only those, the others
+// share the top level keymap
+bool parseAdapterKeymap(const YAML::Node& config, const std::string& id,
+                        KeyTable::KeyTable* key_table, std::string* error)
+{
+  const YAML::Node adapters_config = config["adapters"];
+  for (size_t i = 0; i < adapters_config.size(); i++)
+  {
+    const YAML::Node adapter_config = adapters_config[i];
+
+    if (adapter_config["id"] &&
+        (adapter_config["id"].as<std::string>().compare(id) == 0) &&
+        (adapter_config["keymap"] || adapter_config["macros"]))
+    {
+      return parseKeymap(adapter_config, key_table, error);
+    }
+  }
+
+  return parseKeymap(config, key_table, error);
+}
+
+
+AdapterContext* findAdapter(const std::string& id)
+{
+  for (size_t i = 0; i < adapters.size(); i++)
+  {
+    if (adapters[i]->id.compare(id) == 0)
+    {
+      return adapters[i];
+    }
+  }
+
+  return NULL;
+}
+
+
+bool reloadKeymap(std::string* message)
+{
+  if (configFile.empty())
+  {
+    *message = "No config file was given, there is no keymap to reload";
+    return false;
+  }
+
+  std::vector<KeyTable::KeyTable> key_tables(adapters.size());
+  std::string error;
+
+  // every adapter's new keymap is completely built and checked before
+  // anything is swapped, a bad file leaves the current keymaps in place.
+  // Adapters are only added or removed by a restart.
+  try
+  {
+    YAML::Node config = YAML::LoadFile(configFile);
+
+    for (size_t i = 0; i < adapters.size(); i++)
+    {
+      if (!parseAdapterKeymap(config, adapters[i]->id, &key_tables[i],
+                              &error))
+      {
+        *message = "'" + configFile + "' contains " + error +
+                   " for adapter '" + adapters[i]->id +
+                   "'\nkeeping the current keymap.";
+        return false;
+      }
+    }
+  }
+  catch (YAML::Exception& e)
+  {
+    *message = "Failed to reload '" + configFile + "': " + e.what();
+    return false;
+  }
+
+  for (size_t i = 0; i < adapters.size(); i++)
+  {
+    adapters[i]->key_pipeline->setKeyTable(key_tables[i]);
+
+    std::lock_guard<std::mutex> lock(adapters[i]->key_table_mutex);
+    adapters[i]->key_table = key_tables[i];
+  }
+
+  *message = "Keymap reloaded from '" + configFile + "'";
+  return true;
+}
+
+
+void sendJson(const FrameSender& send, const Json::Value& responseJson)
+{
+  Json::FastWriter fastWriter;
+  std::string frame = fastWriter.write(responseJson);
+  send(frame.data(), frame.size(), websocketpp::frame::opcode::text);
+}
+
+
+// context is the adapter used when the request doesn't name one
+void handleCommand(const Json::Value& request, uint64_t received_ns,
+                   websocketpp::connection_hdl hdl, AdapterContext* context,
+                   JsonResponder respond)
+{
+  Json::Value responseJson;
+
+  if (!request.isObject())
+  {
+    responseJson["success"] = false;
+    responseJson["message"] = "commands must be JSON objects";
+    respond(responseJson);
+    return;
+  }
+
+  // a client supplied id is echoed back so asynchronous results can be
+  // matched to their requests
+  Json::Value id = request.get("id", Json::Value());
+  if (!id.isNull())
+  {
+    responseJson["id"] = id;
+  }
+
+  std::string target = request.get("target", "").asString();
+  std::string command = request.get("command", "").asString();
+  std::string arguments = request.get("args", "").asString();
+
+  if (request.isMember("adapter"))
+  {
+    context = findAdapter(request["adapter"].asString());
+  }
+
+  if (!context)
+  {
+    responseJson["success"] = false;
+    responseJson["message"] = "Unrecognised adapter";
+  }
+  else if (target.compare("stats") == 0)
+  {
+    responseJson["success"] = true;
+    responseJson["message"] = "Pipeline statistics";
+    responseJson["stats"] = statsToJson(context);
+  }
+  else if (target.compare("adapters") == 0)
+  {
+    responseJson["success"] = true;
+    responseJson["message"] = "Adapters";
+    responseJson["adapters"] = adaptersToJson();
+  }
+  else if (!(target.empty() || command.empty()))
+  {
+    CECExecutor::CECExecutor* executor = context->cec_executor;
+
+    if ((target.compare("cec") == 0) &&
+        handleCECQuery(context, command, arguments, &responseJson))
+    {
+      // answered from the cache without going to the bus
+    }
+    else if ((target.compare("cec") == 0) &&
+             !CECExecutor::CECExecutor::isCommand(command))
+    {
+      // turned away before admission, so a typo doesn't use up the
+      // client's rate
+      responseJson["success"] = false;
+      responseJson["message"] = "The CEC command given was invalid";
+    }
+    else if ((target.compare("cec") == 0) && !executor)
+    {
+      responseJson["success"] = false;
+      responseJson["message"] = "The CEC adapter is not connected yet";
+    }
+    else if ((target.compare("cec") == 0) &&
+             !admitWork(hdl, context, RateLimiter::TARGET_CEC, 1,
+                        &responseJson))
+    {
+      // answered as busy
+    }
+    else if (target.compare("cec") == 0)
+    {
+      bool submitted = executor->submit(command, arguments,
+        [responseJson, respond](const CECExecutor::Result& result)
+        {
+          Json::Value cecResponseJson = responseJson;
+          cecResponseJson["success"] = result.success;
+          cecResponseJson["message"] = result.message;
+          respond(cecResponseJson);
+        });
+
+      if (submitted)
+      {
+        return;
+      }
+
+      responseJson["success"] = false;
+      responseJson["message"] = "The CEC command given was invalid";
+    }
+    else if (target.compare("macro") == 0)
+    {
+      // admitted by the number of keys it sends, answered once the last
+      // of them has been queued
+      runMacroCommand(context, hdl, command, arguments, responseJson,
+                      respond);
+      return;
+    }
+    else if ((target.compare("config") == 0) &&
+             (command.compare("reload") == 0))
+    {
+      // answered once the new keymap is in use, or failed to load
+      config_reloader->request(
+        [responseJson, respond](bool success, const std::string& message)
+        {
+          Json::Value reloadResponseJson = responseJson;
+          reloadResponseJson["success"] = success;
+          reloadResponseJson["message"] = message;
+          respond(reloadResponseJson);
+        });
+      return;
+    }
+    else if (target.compare("events") == 0)
+    {
+      handleEventsCommand(command, arguments, hdl, &responseJson);
+    }
+    else if (target.compare("key") == 0)
+    {
+      UserInputDevice::Chord chord;
+      if (getInputChord(command, &chord))
+      {
+        if (!admitWork(hdl, context, RateLimiter::TARGET_KEY, 1,
+                       &responseJson))
+        {
+          // answered as busy
+        }
+        else if (context->key_pipeline->queueKey(chord,
+                                                 UserInputDevice::ACTION_TAP,
+                                                 KeyQueue::SOURCE_WEBSOCKET,
+                                                 received_ns))
+        {
+          responseJson["success"] = true;
+          responseJson["message"] = "key code received";
+        }
+        else
+        {
+          responseJson["success"] = false;
+          responseJson["message"] = "Key queue full, key dropped";
+        }
+      }
+      else
+      {
+        responseJson["success"] = false;
+        responseJson["message"] = "Unrecognised key command";
+      }
+    }
+    else
+    {
+      responseJson["success"] = false;
+      responseJson["message"] = "Unrecognised command type";
+    }
+  }
+  else
+  {
+    responseJson["success"] = false;
+    responseJson["message"] = "target and command are both required parameters";
+  }
+
+  respond(responseJson);
+}
+
+
+// Results of a batch, answered once every command in it has completed
+struct BatchResponse
+{
+  std::mutex mutex;
+  Json::Value results;
+  size_t outstanding;
+  JsonResponder respond;
+
+  void complete(Json::ArrayIndex index, const Json::Value& result)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    results[index] = result;
+    finish(lock);
+  }
+
+  // drops the extra count held while the batch is being submitted, so an
+  // empty or fully synchronous batch can't answer before every command in
+  // it was seen
+  void release(void)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    finish(lock);
+  }
+
+  void finish(std::unique_lock<std::mutex>& lock)
+  {
+    if (--outstanding > 0)
+    {
+      return;
+    }
+
+    bool success = true;
+    for (Json::ArrayIndex i = 0; i < results.size(); i++)
+    {
+      success = success && results[i]["success"].asBool();
+    }
+
+    Json::Value responseJson;
+    responseJson["success"] = success;
+    responseJson["message"] = success ? "All commands succeeded"
+                                      : "One or more commands failed";
+    responseJson["results"] = results;
+    lock.unlock();
+
+    respond(responseJson);
+  }
+};
+
+
+// Keys of a batch bound for one adapter
+struct KeyBatch
+{
+  std::vector<UserInputDevice::KeyEvent> events;
+  std::vector<Json::ArrayIndex> items;
+};
+
+
+void handleBatch(const Json::Value& requests, uint64_t received_ns,
+                 websocketpp::connection_hdl hdl, AdapterContext* context,
+                 JsonResponder respond)
+{
+  std::shared_ptr<BatchResponse> batch = std::make_shared<BatchResponse>();
+  batch->results = Json::Value(Json::arrayValue);
+  batch->results.resize(requests.size());
+  batch->outstanding = requests.size() + 1;
+  batch->respond = respond;
+
+  std::map<AdapterContext*, KeyBatch> key_batches;
+  std::vector<Json::ArrayIndex> other_items;
+
+  // valid keys are queued together in a single step for each adapter,
+  // ahead of the other commands, so the batch reaches each input device in
+  // order without keys from other clients in between
+  for (Json::ArrayIndex i = 0; i < requests.size(); i++)
+  {
+    const Json::Value& request = requests[i];
+    UserInputDevice::Chord chord;
+    AdapterContext* key_context = context;
+
+    if (request.isObject() && request.isMember("adapter"))
+    {
+      key_context = findAdapter(request["adapter"].asString());
+    }
+
+    if (key_context && request.isObject() &&
+        (request.get("target", "").asString().compare("key") == 0) &&
+        getInputChord(request.get("command", "").asString(), &chord))
+    {
+      UserInputDevice::KeyEvent event = {chord, UserInputDevice::ACTION_TAP};
+      key_batches[key_context].events.push_back(event);
+      key_batches[key_context].items.push_back(i);
+    }
+    else
+    {
+      other_items.push_back(i);
+    }
+  }
+
+  std::map<AdapterContext*, KeyBatch>::iterator it;
+  for (it = key_batches.begin(); it != key_batches.end(); ++it)
+  {
+    AdapterContext* key_context = it->first;
+    const KeyBatch& keys = it->second;
+
+    // the keys are admitted or turned away together, like they are queued
+    Json::Value keys_result;
+    if (admitWork(hdl, key_context, RateLimiter::TARGET_KEY,
+                  keys.events.size(), &keys_result))
+    {
+      bool keys_queued =
+        key_context->key_pipeline->queueKeys(keys.events.data(),
+                                             keys.events.size(),
+                                             KeyQueue::SOURCE_WEBSOCKET,
+                                             received_ns);
+
+      keys_result["success"] = keys_queued;
+      keys_result["message"] = keys_queued
+                               ? "key code received"
+                               : "Key queue full, key batch dropped";
+    }
+
+    for (size_t i = 0; i < keys.items.size(); i++)
+    {
+      Json::Value result = keys_result;
+      Json::Value id = requests[keys.items[i]].get("id", Json::Value());
+      if (!id.isNull())
+      {
+        result["id"] = id;
+      }
+
+      batch->complete(keys.items[i], result);
+    }
+  }
+
+  for (size_t i = 0; i < other_items.size(); i++)
+  {
+    Json::ArrayIndex index = other_items[i];
+    handleCommand(requests[index], received_ns, hdl, context,
+                  [batch, index](const Json::Value& result)
+                  {
+                    batch->complete(index, result);
+                  });
+  }
+
+  batch->release();
+}
+
+
+BinaryProtocol::Status queueBinaryKeys(const BinaryProtocol::Request& request,
+                                       uint64_t received_ns,
+                                       websocketpp::connection_hdl hdl,
+                                       AdapterContext* context)
+{
+  size_t count = BinaryProtocol::keyCount(request);
+  if (count == 0)
+  {
+    return BinaryProtocol::STATUS_BAD_FRAME;
+  }
+
+  UserInputDevice::KeyAction action = UserInputDevice::ACTION_TAP;
+  if (request.command == BinaryProtocol::CMD_KEY_PRESS)
+  {
+    action = UserInputDevice::ACTION_PRESS;
+  }
+  else if (request.command == BinaryProtocol::CMD_KEY_RELEASE)
+  {
+    action = UserInputDevice::ACTION_RELEASE;
+  }
+
+  UserInputDevice::KeyEvent events[BinaryProtocol::MAX_KEYS];
+  for (size_t i = 0; i < count; i++)
+  {
+    int key = BinaryProtocol::keyAt(request, i);
+    events[i].chord = UserInputDevice::singleKey(key);
+    events[i].action = action;
+
+    // only codes with a name in ceckeymap.h are registered on the device
+    if (getKeyStr(key)[0] == '\0')
+    {
+      return BinaryProtocol::STATUS_BAD_ARGUMENT;
+    }
+  }
+
+  if (!admitWork(hdl, context, RateLimiter::TARGET_KEY, count, NULL))
+  {
+    return BinaryProtocol::STATUS_BUSY;
+  }
+
+  if (!context->key_pipeline->queueKeys(events, count,
+                                        KeyQueue::SOURCE_WEBSOCKET,
+                                        received_ns))
+  {
+    return BinaryProtocol::STATUS_QUEUE_FULL;
+  }
+
+  return BinaryProtocol::STATUS_OK;
+}
+
+
+bool transmitRoundTrips(CECAdapter::CECAdapter* adapter,
+                        const BinaryProtocol::Request& request,
+                        const char* arguments)
+{
+  CEC::cec_command frame = adapter->CommandFromString(arguments);
+  uint8_t bytes[BinaryProtocol::MAX_TRANSMIT_BYTES];
+  size_t size = 0;
+
+  bytes[size++] = (uint8_t) ((frame.initiator << 4) | frame.destination);
+  if (frame.opcode_set)
+  {
+    bytes[size++] = (uint8_t) frame.opcode;
+  }
+
+  for (uint8_t i = 0; (i < frame.parameters.size) &&
+                      (size < sizeof(bytes)); i++)
+  {
+    bytes[size++] = frame.parameters.data[i];
+  }
+
+  return (size == request.payload_size) &&
+         (memcmp(bytes, request.payload, size) == 0);
+}
+
+
+bool execBinaryCECCommand(const BinaryProtocol::Request& request,
+                          websocketpp::connection_hdl hdl,
+                          AdapterContext* context, BinaryResponder respond)
+{
+  const char* command = NULL;
+  char arguments[BinaryProtocol::TRANSMIT_TEXT_SIZE] = "";
+
+  if (request.command == BinaryProtocol::CMD_CEC_TRANSMIT)
+  {
+    if (!BinaryProtocol::formatTransmit(request, arguments))
+    {
+      respond(BinaryProtocol::STATUS_BAD_FRAME);
+      return false;
+    }
+
+    command = "transmit";
+  }
+  else
   {
-    if (cec_adapter->SetInactiveView())
+    uint8_t cec_command;
+    uint16_t argument;
+
+    if (!BinaryProtocol::parseCECCommand(request, &cec_command, &argument))
+    {
+      respond(BinaryProtocol::STATUS_BAD_FRAME);
+      return false;
+    }
+
+    switch (cec_command)
+    {
+      case BinaryProtocol::CEC_ON:
+        command = "on";
+        break;
+      case BinaryProtocol::CEC_STANDBY:
+        command = "standby";
+        break;
+      case BinaryProtocol::CEC_SET_ADDR_ACTIVE:
+        command = "set_addr_active";
+        break;
+      case BinaryProtocol::CEC_ACTIVATE:
+        command = "activate";
+        break;
+      case BinaryProtocol::CEC_DEACTIVATE:
+        command = "deactivate";
+        break;
+      case BinaryProtocol::CEC_VOLUP:
+        command = "volup";
+        break;
+      case BinaryProtocol::CEC_VOLDOWN:
+        command = "voldown";
+        break;
+      case BinaryProtocol::CEC_MUTE:
+        command = "mute";
+        break;
+      default:
+        respond(BinaryProtocol::STATUS_UNKNOWN_COMMAND);
+        return false;
+    }
+
+    snprintf(arguments, sizeof(arguments), "%x", argument);
+  }
+
+  CECExecutor::CECExecutor* executor = context->cec_executor;
+  if (!executor)
+  {
+    respond(BinaryProtocol::STATUS_FAILED);
+    return false;
+  }
+
+  // the text must parse back to exactly the frame the client sent, or
+  // libcec would transmit something else and still report success
+  if ((request.command == BinaryProtocol::CMD_CEC_TRANSMIT) &&
+      !transmitRoundTrips(context->cec_adapter, request, arguments))
+  {
+    respond(BinaryProtocol::STATUS_BAD_ARGUMENT);
+    return false;
+  }
+
+  if (!admitWork(hdl, context, RateLimiter::TARGET_CEC, 1, NULL))
+  {
+    respond(BinaryProtocol::STATUS_BUSY);
+    return false;
+  }
+
+  return executor->submit(command, arguments,
+    [respond](const CECExecutor::Result& result)
+    {
+      respond(result.success ? BinaryProtocol::STATUS_OK
+                             : BinaryProtocol::STATUS_FAILED);
+    });
+}
+
+
+// binary frames have no room to name an adapter, they go to the one the
+// connection was opened for
+void handleBinaryMessage(const FrameSender& send,
+                         websocketpp::connection_hdl hdl,
+                         AdapterContext* context, const std::string& payload,
+                         uint64_t received_ns)
+{
+  BinaryProtocol::Request request;
+  BinaryProtocol::Status status;
+
+  // key frames are answered straight from the stack, only CEC commands,
+  // which finish on the executor thread, need a responder that outlives
+  // this call
+  if (!BinaryProtocol::parseRequest(payload.data(), payload.size(),
+                                    &request))
+  {
+    status = BinaryProtocol::STATUS_BAD_FRAME;
+  }
+  else if ((request.command == BinaryProtocol::CMD_KEY_TAP) ||
+           (request.command == BinaryProtocol::CMD_KEY_PRESS) ||
+           (request.command == BinaryProtocol::CMD_KEY_RELEASE))
+  {
+    status = queueBinaryKeys(request, received_ns, hdl, context);
+  }
+  else if ((request.command == BinaryProtocol::CMD_CEC) ||
+           (request.command == BinaryProtocol::CMD_CEC_TRANSMIT))
+  {
+    BinaryResponder respond = [send, request](BinaryProtocol::Status result)
+    {
+      uint8_t response[BinaryProtocol::RESPONSE_SIZE];
+      BinaryProtocol::encodeResponse(request, result, response);
+      send(response, sizeof(response), websocketpp::frame::opcode::binary);
+    };
+
+    // responds once the command has run on the bus
+    execBinaryCECCommand(request, hdl, context, respond);
+    return;
+  }
+  else
+  {
+    status = BinaryProtocol::STATUS_UNKNOWN_COMMAND;
+  }
+
+  uint8_t response[BinaryProtocol::RESPONSE_SIZE];
+  BinaryProtocol::encodeResponse(request, status, response);
+  send(response, sizeof(response), websocketpp::frame::opcode::binary);
+}
+
+
+void wsMessageCB(websocketpp::server<websocketpp::config::asio>* serv,
+                 websocketpp::connection_hdl hdl,
+                 websocketpp::server<websocketpp::config::asio>::message_ptr msg)
+{
+  uint64_t received_ns = Stats::monotonicNs();
+  bool binary = (msg->get_opcode() == websocketpp::frame::opcode::binary);
+  AdapterContext* context = connectionAdapter(serv, hdl);
+
+  if (recorder)
+  {
+    recorder->wsMessage(context->index, binary, msg->get_payload(),
+                        received_ns);
+  }
+
+  FrameSender send = [serv, hdl](const void* frame, size_t size,
+                                 websocketpp::frame::opcode::value opcode)
+  {
+    try
+    {
+      serv->send(hdl, frame, size, opcode);
+    }
+    catch (websocketpp::exception const & e)
+    {
+      Logger::log(Logger::LEVEL_WARNING,
+                  "Failed to respond to websocket client: %s", e.what());
+    }
+  };
+
+  handleMessage(msg->get_payload(), binary, received_ns, hdl, context, send);
+}
+
+
+// the adapter named by the path the connection was opened on, e.g.
+// "/adapter/living_room", or the first adapter for any other path
+AdapterContext* connectionAdapter(
+  websocketpp::server<websocketpp::config::asio>* serv,
+  websocketpp::connection_hdl hdl)
+{
+  static const std::string prefix = "/adapter/";
+
+  std::string resource = serv->get_con_from_hdl(hdl)->get_resource();
+  resource = resource.substr(0, resource.find('?'));
+
+  if (resource.compare(0, prefix.size(), prefix) != 0)
+  {
+    return adapters[0];
+  }
+
+  return findAdapter(resource.substr(prefix.size()));
+}
+
+
+// refuses connections for an adapter that doesn't exist, so every open
+// connection has one
+bool wsValidateCB(websocketpp::server<websocketpp::config::asio>* serv,
+                  websocketpp::connection_hdl hdl)
+{
+  if (connectionAdapter(serv, hdl))
+  {
+    return true;
+  }
+
+  serv->get_con_from_hdl(hdl)->set_status(
+    websocketpp::http::status_code::not_found);
+  return false;
+}
+
+
+void handleMessage(const std::string& payload, bool binary,
+                   uint64_t received_ns, websocketpp::connection_hdl hdl,
+                   AdapterContext* context, const FrameSender& send)
+{
+  if (binary)
+  {
+    handleBinaryMessage(send, hdl, context, payload, received_ns);
+    return;
+  }
+
+  Json::Value recievedJson;
+  Json::Reader reader;
+
+  JsonResponder respond = [send](const Json::Value& responseJson)
+  {
+    sendJson(send, responseJson);
+  };
+
+  if (reader.parse(payload.c_str(), recievedJson))
+  {
+    if (recievedJson.isArray())
     {
-      *response = "Device set as inactive";
+      handleBatch(recievedJson, received_ns, hdl, context, respond);
     }
     else
     {
-      *response = "Failed to set device inactive view";
+      handleCommand(recievedJson, received_ns, hdl, context, respond);
     }
   }
-  else if (cmd.compare("volup") == 0)
+  else
+  {
+    Json::Value responseJson;
+    responseJson["success"] = false;
+    responseJson["message"] = reader.getFormattedErrorMessages();
+    respond(responseJson);
+  }
+}
+
+
+void handleEventsCommand(const std::string& command,
+                         const std::string& arguments,
+                         websocketpp::connection_hdl hdl,
+                         Json::Value* responseJson)
+{
+  EventStream::EventStream* stream = event_stream;
+  uint32_t mask;
+
+  if (!stream)
+  {
+    // replayed without the websocket server running
+    (*responseJson)["success"] = false;
+    (*responseJson)["message"] = "Events are not available";
+  }
+  else if (command.compare("subscribe") == 0)
   {
-    if (cec_adapter->VolumeUp())
+    if (EventStream::parseEventMask(arguments, &mask))
     {
-      *response = "Volume increased";
+      stream->subscribe(hdl, mask);
+      (*responseJson)["success"] = true;
+      (*responseJson)["message"] = "Subscribed to events";
     }
     else
     {
-      *response = "Failed change volume";
+      (*responseJson)["success"] = false;
+      (*responseJson)["message"] =
+        "Unrecognised event type, expected key, unmapped, source or power";
+    }
+  }
+  else if (command.compare("unsubscribe") == 0)
+  {
+    (*responseJson)["success"] = stream->unsubscribe(hdl);
+    (*responseJson)["message"] = (*responseJson)["success"].asBool()
+                                 ? "Unsubscribed from events"
+                                 : "Not subscribed to events";
+  }
+  else
+  {
+    (*responseJson)["success"] = false;
+    (*responseJson)["message"] = "Unrecognised events command";
+  }
+}
+
+
+bool handleCECQuery(AdapterContext* context, const std::string& command,
+                    const std::string& arguments, Json::Value* responseJson)
+{
+  if ((command.compare("devices") != 0) && (command.compare("power") != 0) &&
+      (command.compare("active") != 0) && (command.compare("vendor") != 0) &&
+      (command.compare("name") != 0))
+  {
+    return false;
+  }
+
+  CECCache::CECCache* cache = context->cec_cache;
+  if (!cache)
+  {
+    (*responseJson)["success"] = false;
+    (*responseJson)["message"] = "The CEC adapter is not connected yet";
+    return true;
+  }
+
+  uint64_t now_ns = Stats::monotonicNs();
+  uint64_t refreshed_ns = cache->refreshedNs();
+  (*responseJson)["refreshed_ms_ago"] = (refreshed_ns > 0)
+    ? Json::Value((Json::UInt64) ((now_ns - refreshed_ns) / 1000000))
+    : Json::Value();
+
+  if (command.compare("devices") == 0)
+  {
+    Json::Value devicesJson(Json::arrayValue);
+
+    for (int i = 0; i < CEC::CECDEVICE_BROADCAST; i++)
+    {
+      CEC::cec_logical_address address = (CEC::cec_logical_address) i;
+      CECCache::Device device = cache->device(address);
+
+      if (device.present)
+      {
+        devicesJson.append(cecDeviceToJson(context, address, device,
+                                           now_ns));
+      }
     }
+
+    (*responseJson)["success"] = true;
+    (*responseJson)["message"] = "Devices on the bus";
+    (*responseJson)["devices"] = devicesJson;
+    return true;
   }
-  else if (cmd.compare("voldown") == 0)
+
+  if (command.compare("active") == 0)
   {
-    if (cec_adapter->VolumeDown())
+    CEC::cec_logical_address address = cache->activeSource();
+
+    (*responseJson)["success"] = true;
+    if ((address >= 0) && (address < CEC::CECDEVICE_BROADCAST))
     {
-      *response = "Volume decreased";
+      (*responseJson)["message"] = "Active source";
+      (*responseJson)["device"] =
+        cecDeviceToJson(context, address, cache->device(address), now_ns);
     }
     else
     {
-      *response = "Failed change volume";
+      (*responseJson)["message"] = "No active source";
     }
+    return true;
+  }
+
+  // the remaining queries are about a single device
+  int addr = -1;
+  if ((sscanf(arguments.c_str(), "%x", &addr) != 1) || (addr < 0) ||
+      (addr >= CEC::CECDEVICE_BROADCAST))
+  {
+    (*responseJson)["success"] = false;
+    (*responseJson)["message"] = "A logical address from 0 to e is required";
+    return true;
+  }
+
+  CEC::cec_logical_address address = (CEC::cec_logical_address) addr;
+  CECCache::Device device = cache->device(address);
+
+  if (!device.present)
+  {
+    (*responseJson)["success"] = false;
+    (*responseJson)["message"] = "No device has been seen at that address";
+    return true;
+  }
+
+  Json::Value deviceJson = cecDeviceToJson(context, address, device, now_ns);
+  (*responseJson)["success"] = true;
+  (*responseJson)["message"] = "Device " + command;
+  (*responseJson)["address"] = deviceJson["address"];
+  (*responseJson)["age_ms"] = deviceJson["age_ms"];
+
+  if (command.compare("power") == 0)
+  {
+    (*responseJson)["power"] = deviceJson["power"];
+  }
+  else if (command.compare("vendor") == 0)
+  {
+    (*responseJson)["vendor"] = deviceJson["vendor"];
+    (*responseJson)["vendor_id"] = deviceJson["vendor_id"];
+  }
+  else
+  {
+    (*responseJson)["name"] = deviceJson["name"];
+  }
+
+  return true;
+}
+
+
+Json::Value cecDeviceToJson(AdapterContext* context,
+                            CEC::cec_logical_address address,
+                            const CECCache::Device& device, uint64_t now_ns)
+{
+  CECAdapter::CECAdapter* cec_adapter = context->cec_adapter;
+
+  char physical_address[16];
+  snprintf(physical_address, sizeof(physical_address), "%x.%x.%x.%x",
+           (device.physical_address >> 12) & 0xF,
+           (device.physical_address >> 8) & 0xF,
+           (device.physical_address >> 4) & 0xF,
+           device.physical_address & 0xF);
+
+  Json::Value deviceJson;
+  deviceJson["address"] = address;
+  deviceJson["type"] = cec_adapter->ToString(address);
+  deviceJson["physical_address"] =
+    (device.physical_address != CEC_INVALID_PHYSICAL_ADDRESS)
+    ? Json::Value(physical_address) : Json::Value();
+  deviceJson["power"] = cec_adapter->ToString(device.power_status);
+  deviceJson["vendor_id"] = device.vendor_id;
+  deviceJson["vendor"] = cec_adapter->VendorIdToString(device.vendor_id);
+  deviceJson["name"] = device.osd_name;
+  deviceJson["age_ms"] =
+    (Json::UInt64) ((now_ns - device.updated_ns) / 1000000);
+  return deviceJson;
+}
+
+
+// the queue limits are for the adapter the work is for, the rate limits
+// are for the client across every adapter
+bool admitWork(websocketpp::connection_hdl hdl, AdapterContext* context,
+               RateLimiter::Target target, size_t count,
+               Json::Value* responseJson)
+{
+  size_t queued = 0;
+  if (target == RateLimiter::TARGET_KEY)
+  {
+    queued = context->key_pipeline->queue().size();
+  }
+  else
+  {
+    CECExecutor::CECExecutor* executor = context->cec_executor;
+    queued = executor ? executor->pending() : 0;
+  }
+
+  RateLimiter::RateLimiter* limiter = rate_limiter;
+  if (!limiter)
+  {
+    // replayed without the websocket server running
+    return true;
+  }
+
+  RateLimiter::Decision decision = limiter->admit(hdl, target, count, queued);
+
+  if (decision == RateLimiter::ADMITTED)
+  {
+    return true;
+  }
+
+  if (responseJson)
+  {
+    (*responseJson)["success"] = false;
+    (*responseJson)["busy"] = true;
+    (*responseJson)["message"] = (decision == RateLimiter::RATE_LIMITED)
+      ? "Too many commands, slow down"
+      : "Server busy, try again later";
+  }
+
+  return false;
+}
+
+
+void wsOpenCB(websocketpp::connection_hdl)
+{
+  ws_connections++;
+}
+
+
+void wsCloseCB(websocketpp::connection_hdl hdl)
+{
+  ws_connections--;
+  event_stream.load()->unsubscribe(hdl);
+  rate_limiter.load()->remove(hdl);
+}
+
+
+void wsHttpCB(websocketpp::server<websocketpp::config::asio>* serv,
+              websocketpp::connection_hdl hdl)
+{
+  websocketpp::server<websocketpp::config::asio>::connection_ptr con =
+    serv->get_con_from_hdl(hdl);
+
+  std::string resource = con->get_resource();
+  resource = resource.substr(0, resource.find('?'));
+
+  if (resource.compare("/metrics") == 0)
+  {
+    con->set_status(websocketpp::http::status_code::ok);
+    con->append_header("Content-Type", "text/plain; version=0.0.4");
+    con->set_body(metricsText());
+  }
+  else
+  {
+    con->set_status(websocketpp::http::status_code::not_found);
+    con->set_body("Not found\n");
   }
-  else if (cmd.compare("mute") == 0)
+}
+
+
+void runMacroCommand(AdapterContext* context, websocketpp::connection_hdl hdl,
+                     const std::string& command, const std::string& arguments,
+                     Json::Value responseJson, JsonResponder respond)
+{
+  std::shared_ptr<const KeyTable::Sequence> sequence;
+
+  if (command.compare("sequence") == 0)
   {
-    if (cec_adapter->AudioToggleMute())
+    std::shared_ptr<KeyTable::Sequence> parsed =
+      std::make_shared<KeyTable::Sequence>();
+
+    // a sequence can't usefully be longer than the key queue, the keys
+    // with no delay between them are all queued at once
+    if (MacroRunner::parseSequence(arguments, macroDelayMs, keyQueueSize,
+                                   parsed.get()))
     {
-      *response = "Mute toggled";
+      sequence = parsed;
     }
-    else
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(context->key_table_mutex);
+    int macro = context->key_table.findMacro(command);
+    if (macro >= 0)
     {
-      *response = "Failed to toggle mute";
+      sequence = context->key_table.macros()[macro].sequence;
     }
   }
-  else
+
+  if (!sequence)
   {
-    *response = "The CEC command given was invalid";
-    return false;
+    responseJson["success"] = false;
+    responseJson["message"] = "Unrecognised macro or invalid key sequence";
+    respond(responseJson);
+    return;
   }
 
-  return true;
+  // every key of the macro counts against the client's rate and the queue
+  // limit, one that could never fit in either is refused outright rather
+  // than reported as busy
+  size_t keys = MacroRunner::keyCount(*sequence);
+  const RateLimiter::Limit& limit = rateLimits[RateLimiter::TARGET_KEY];
+
+  if (((limit.max_queued > 0) && (keys > limit.max_queued)) ||
+      ((limit.rate > 0) && (keys > limit.burst)))
+  {
+    responseJson["success"] = false;
+    responseJson["message"] = "Macro has more keys than a client may queue";
+    respond(responseJson);
+    return;
+  }
+
+  if (!admitWork(hdl, context, RateLimiter::TARGET_KEY, keys, &responseJson))
+  {
+    respond(responseJson);
+    return;
+  }
+
+  context->macro_runner->run(sequence, KeyQueue::SOURCE_WEBSOCKET,
+    [responseJson, respond](bool success)
+    {
+      Json::Value macroResponseJson = responseJson;
+      macroResponseJson["success"] = success;
+      macroResponseJson["message"] =
+        success ? "Macro played" : "Key queue full, macro keys dropped";
+      respond(macroResponseJson);
+    });
 }
 
 
-void wsMessageCB(websocketpp::server<websocketpp::config::asio>* serv,
-                 websocketpp::connection_hdl hdl,
-                 websocketpp::server<websocketpp::config::asio>::message_ptr msg)
+void playCECMacro(AdapterContext* context, const KeyTable::Macro& macro)
 {
-  hdl.lock().get();
-  std::string response;
-  Json::Value recievedJson;
-  Json::Reader reader;
-  Json::Value responseJson;
+  context->macro_runner->run(macro.sequence, KeyQueue::SOURCE_CEC,
+                             MacroRunner::Completion());
+}
 
-  if (reader.parse(msg->get_payload().c_str(), recievedJson))
+
+void publishKeyEvent(AdapterContext* context, const CEC::cec_keypress& msg,
+                     const KeyTable::KeyTable& key_table)
+{
+  EventStream::EventStream* stream = event_stream;
+  if (!stream)
   {
-    std::string target = recievedJson.get("target", "").asString();
-    std::string command = recievedJson.get("command", "").asString();
-    std::string arguments = recievedJson.get("args", "").asString();
-    if (!(target.empty() || command.empty()))
-    {
-      if (target.compare("cec") == 0)
-      {
-        std::string exec_response;
-        responseJson["success"] = execCECCommand(command, arguments,
-                                                 &exec_response);
-        responseJson["message"] = exec_response;
+    return;
+  }
 
-      }
-      else if (target.compare("key") == 0)
+  const KeyTable::Binding& binding = key_table.binding(msg.keycode);
+
+  if ((binding.chord.count > 0) || (binding.macro >= 0))
+  {
+    if (stream->wants(EventStream::EVENT_KEY))
+    {
+      Json::Value eventJson;
+      eventJson["event"] = "key";
+      eventJson["adapter"] = context->id;
+      eventJson["code"] = getCECControlStr(msg.keycode);
+      if (binding.macro >= 0)
       {
-        int kCode;
-        if (getInputKeyCode(command, &kCode))
-        {
-          responseJson["success"] = true;
-          responseJson["message"] = "key code received";
-          std::lock_guard<std::mutex> lock(key_mutex);
-          key_queue.push(kCode);
-        }
-        else
-        {
-          responseJson["success"] = false;
-          responseJson["message"] = "Unrecognised key command";
-        }
+        eventJson["macro"] = key_table.macros()[binding.macro].name;
       }
       else
       {
-        responseJson["success"] = false;
-        responseJson["message"] = "Unrecognised command type";
+        eventJson["key"] = getChordStr(binding.chord);
       }
-    }
-    else
-    {
-      responseJson["success"] = false;
-      responseJson["message"] = "target and command are both required parameters";
+      eventJson["duration"] = msg.duration;
+      stream->publish(EventStream::EVENT_KEY, eventJson);
     }
   }
-  else
+  else if ((msg.duration == 0) && stream->wants(EventStream::EVENT_UNMAPPED))
   {
-    responseJson["success"] = false;
-    responseJson["message"] = reader.getFormattedErrorMessages();
+    Json::Value eventJson;
+    eventJson["event"] = "unmapped";
+    eventJson["adapter"] = context->id;
+    eventJson["code"] = getCECControlStr(msg.keycode);
+    stream->publish(EventStream::EVENT_UNMAPPED, eventJson);
   }
+}
 
-  Json::FastWriter fastWriter;
-  response = fastWriter.write(responseJson);
 
-  try
+void cecCommandCB(void* cbparam, const CEC::cec_command* command)
+{
+  AdapterContext* context = static_cast<AdapterContext*>(cbparam);
+  CECAdapter::CECAdapter* cec_adapter = context->cec_adapter;
+  CECCache::CECCache* cache = context->cec_cache;
+  if (cache)
   {
-      serv->send(hdl, response, msg->get_opcode());
+    cache->commandReceived(*command);
   }
-  catch (websocketpp::exception const & e)
+
+  EventStream::EventStream* stream = event_stream;
+  if (!stream)
   {
-    std::cerr << "Failed to respond to websocket client." << std::endl
-              << e.what() << std::endl;
+    return;
   }
 
-  return;
+  Json::Value eventJson;
+  eventJson["adapter"] = context->id;
+  eventJson["address"] = command->initiator;
+
+  switch (command->opcode)
+  {
+    case CEC::CEC_OPCODE_ACTIVE_SOURCE:
+    case CEC::CEC_OPCODE_INACTIVE_SOURCE:
+      if (stream->wants(EventStream::EVENT_SOURCE) &&
+          (command->parameters.size >= 2))
+      {
+        eventJson["event"] = "source";
+        eventJson["active"] =
+          (command->opcode == CEC::CEC_OPCODE_ACTIVE_SOURCE);
+        eventJson["physical_address"] =
+          (command->parameters[0] << 8) | command->parameters[1];
+        stream->publish(EventStream::EVENT_SOURCE, eventJson);
+      }
+      break;
+    case CEC::CEC_OPCODE_REPORT_POWER_STATUS:
+      if (stream->wants(EventStream::EVENT_POWER) &&
+          (command->parameters.size >= 1))
+      {
+        eventJson["event"] = "power";
+        eventJson["status"] = cec_adapter->ToString(
+          (CEC::cec_power_status) command->parameters[0]);
+        stream->publish(EventStream::EVENT_POWER, eventJson);
+      }
+      break;
+    case CEC::CEC_OPCODE_STANDBY:
+      if (stream->wants(EventStream::EVENT_POWER))
+      {
+        eventJson["event"] = "power";
+        eventJson["status"] = cec_adapter->ToString(
+          CEC::CEC_POWER_STATUS_STANDBY);
+        stream->publish(EventStream::EVENT_POWER, eventJson);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+
+void cecSourceActivatedCB(void* cbparam,
+                          const CEC::cec_logical_address address,
+                          const uint8_t activated)
+{
+  AdapterContext* context = static_cast<AdapterContext*>(cbparam);
+  CECCache::CECCache* cache = context->cec_cache;
+  if (cache)
+  {
+    cache->sourceActivated(address, activated != 0);
+  }
+
+  EventStream::EventStream* stream = event_stream;
+  if (stream && stream->wants(EventStream::EVENT_SOURCE))
+  {
+    Json::Value eventJson;
+    eventJson["event"] = "source";
+    eventJson["adapter"] = context->id;
+    eventJson["address"] = address;
+    eventJson["active"] = (activated != 0);
+    stream->publish(EventStream::EVENT_SOURCE, eventJson);
+  }
 }
 
 
@@ -564,92 +2597,374 @@ void print_usage(std::string prog_name)
       << std::endl << "\t-p {port}   - websocket server port (default: websocket disabled)"
       << std::endl << "\t-m          - dump config yaml and exit"
       << std::endl << "\t-n {name}   - CEC device name, max length=13 {default: cec_keyboard}"
+      << std::endl << "\t-t {count}  - websocket server threads, 1-64 (default: 1)"
+      << std::endl << "\t--record {file}      - record CEC key presses and websocket messages"
+      << std::endl << "\t--replay {file}      - play a recording instead of connecting to CEC, then exit"
+      << std::endl << "\t--replay-speed {x}   - replay x times faster, 0 for no delays (default: 1)"
+      << std::endl << "\t--simulate           - use a simulated CEC bus instead of an adapter"
       << std::endl << std::endl;
 }
 
 
-void sigintHandler(int signal)
+Json::Value histogramToJson(const Stats::Histogram& histogram,
+                            uint64_t divisor)
 {
-  kill_main = true;
+  Json::Value json;
+  json["count"] = (Json::UInt64) histogram.count();
+  json["p50"] = (Json::UInt64) (histogram.percentile(50.0) / divisor);
+  json["p99"] = (Json::UInt64) (histogram.percentile(99.0) / divisor);
+  json["max"] = (Json::UInt64) (histogram.max() / divisor);
+  return json;
 }
 
 
-bool getCECControlCode(std::string control_code_str,
-                       CEC::cec_user_control_code* cec_control_code)
+Json::Value statsToJson(AdapterContext* context)
 {
-  std::map<std::string, CEC::cec_user_control_code>::iterator it =
-    cec_code_map.find(control_code_str);
+  const Stats::PipelineStats& pipeline_stats = context->key_pipeline->stats();
+  const KeyQueue::KeyQueue& key_queue = context->key_pipeline->queue();
+
+  Json::Value json;
+  json["adapter"] = context->id;
+  json["keys"]["cec"] = (Json::UInt64) pipeline_stats.cec_keys.load();
+  json["keys"]["websocket"] = (Json::UInt64) pipeline_stats.ws_keys.load();
+  json["unmapped_codes"] = (Json::UInt64) pipeline_stats.unmapped_codes.load();
+  json["dropped_keys"] = (Json::UInt64) key_queue.overflows();
+  json["write_errors"] = (Json::UInt64) pipeline_stats.write_errors.load();
+  json["failed_keys"] = (Json::UInt64) pipeline_stats.failed_keys.load();
+  json["wakeups"] = (Json::UInt64) pipeline_stats.wakeups.load();
+  json["drained"] = histogramToJson(pipeline_stats.drained_per_wakeup, 1);
+  json["queue_depth"] = (Json::UInt64) key_queue.size();
+  json["latency_us"]["cec"] =
+    histogramToJson(pipeline_stats.cec_latency_ns, 1000);
+  json["latency_us"]["websocket"] =
+    histogramToJson(pipeline_stats.ws_latency_ns, 1000);
+
+  CECExecutor::CECExecutor* executor = context->cec_executor;
+  if (executor)
+  {
+    const Stats::CECStats& cec_stats = executor->stats();
+    json["cec"]["commands"] = (Json::UInt64) cec_stats.commands.load();
+    json["cec"]["coalesced"] = (Json::UInt64) cec_stats.coalesced.load();
+    json["cec"]["superseded"] = (Json::UInt64) cec_stats.superseded.load();
+    json["cec"]["failed"] = (Json::UInt64) cec_stats.failed.load();
+    json["cec"]["queue_depth"] = histogramToJson(cec_stats.queue_depth, 1);
+    json["cec"]["queue_depth"]["current"] = (Json::UInt64) executor->pending();
+    json["cec"]["latency_us"] = histogramToJson(cec_stats.latency_ns, 1000);
+    json["cec"]["transmit_us"] = histogramToJson(cec_stats.transmit_ns, 1000);
+  }
 
-  if (it == cec_code_map.end())
+  RateLimiter::RateLimiter* limiter = rate_limiter;
+  if (limiter)
   {
-    *cec_control_code = CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UNKNOWN;
-    return false;
+    const char* targets[RateLimiter::TARGETS] = {"key", "cec"};
+    for (int i = 0; i < RateLimiter::TARGETS; i++)
+    {
+      RateLimiter::Target target = (RateLimiter::Target) i;
+      json["rejected"][targets[i]]["rate_limited"] =
+        (Json::UInt64) limiter->rejected(target, RateLimiter::RATE_LIMITED);
+      json["rejected"][targets[i]]["busy"] =
+        (Json::UInt64) limiter->rejected(target, RateLimiter::BUSY);
+    }
   }
 
-  *cec_control_code = it->second;
-  return true;
+  EventStream::EventStream* stream = event_stream;
+  if (stream)
+  {
+    json["events"]["subscribers"] = (Json::UInt64) stream->subscribers();
+    json["events"]["dropped"] = (Json::UInt64) stream->dropped();
+  }
+  return json;
 }
 
 
-bool getInputKeyCode(std::string input_key_str, int* input_key)
+Json::Value adaptersToJson(void)
 {
-  std::map<std::string, int>::iterator it = input_key_map.find(input_key_str);
+  Json::Value json(Json::arrayValue);
 
-  if (it == input_key_map.end())
+  for (size_t i = 0; i < adapters.size(); i++)
   {
-    *input_key = -1;
-    return false;
+    Json::Value adapterJson;
+    adapterJson["id"] = adapters[i]->id;
+    adapterJson["device"] = adapters[i]->cec_device_name;
+    adapterJson["uinput"] = adapters[i]->ui_device_name;
+    adapterJson["connected"] = (adapters[i]->cec_executor.load() != NULL);
+    json.append(adapterJson);
   }
 
-  *input_key = it->second;
-  return true;
+  return json;
 }
 
 
-bool translateCECToKeyCode(CEC::cec_user_control_code cec_control_code,
-                           int* input_key)
+std::string metricsText(void)
 {
-  std::map<CEC::cec_user_control_code, int>::iterator it =
-    cec_to_key.find(cec_control_code);
+  const std::vector<uint64_t> drained_bounds = {1, 2, 4, 8, 16, 32, 64, 128};
+  Metrics::Metrics metrics;
+  size_t i;
+
+  // the key pipeline's counters are all atomics, so a scrape never holds
+  // up a key press. Each family is written whole, one sample per adapter,
+  // as the exposition format expects.
+  metrics.family("cec_keyboard_keys_total", "counter",
+                 "Keys sent to the input device.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    const Stats::PipelineStats& pipeline_stats =
+      adapters[i]->key_pipeline->stats();
+    std::string adapter = Metrics::label("adapter", adapters[i]->id);
+
+    metrics.sample("cec_keyboard_keys_total",
+                   adapter + "," + Metrics::label("source", "cec"),
+                   pipeline_stats.cec_keys);
+    metrics.sample("cec_keyboard_keys_total",
+                   adapter + "," + Metrics::label("source", "websocket"),
+                   pipeline_stats.ws_keys);
+  }
 
-  if (it == cec_to_key.end())
+  metrics.family("cec_keyboard_key_latency_seconds", "histogram",
+                 "Time from a key being received to it being sent to the "
+                 "input device.");
+  for (i = 0; i < adapters.size(); i++)
   {
-    *input_key = -1;
-    return false;
+    const Stats::PipelineStats& pipeline_stats =
+      adapters[i]->key_pipeline->stats();
+    std::string adapter = Metrics::label("adapter", adapters[i]->id);
+
+    metrics.histogram("cec_keyboard_key_latency_seconds",
+                      adapter + "," + Metrics::label("source", "cec"),
+                      pipeline_stats.cec_latency_ns,
+                      Metrics::LATENCY_BOUNDS_NS, 1e9);
+    metrics.histogram("cec_keyboard_key_latency_seconds",
+                      adapter + "," + Metrics::label("source", "websocket"),
+                      pipeline_stats.ws_latency_ns,
+                      Metrics::LATENCY_BOUNDS_NS, 1e9);
   }
 
-  *input_key = it->second;
-  return true;
-}
+  metrics.family("cec_keyboard_unmapped_codes_total", "counter",
+                 "Remote buttons pressed that have no mapping in the keymap.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    const Stats::PipelineStats& pipeline_stats =
+      adapters[i]->key_pipeline->stats();
+    std::string adapter = Metrics::label("adapter", adapters[i]->id);
+
+    for (int code = 0; code < 256; code++)
+    {
+      uint64_t count = pipeline_stats.unmapped_by_code[code];
+      if (count > 0)
+      {
+        metrics.sample("cec_keyboard_unmapped_codes_total",
+                       adapter + "," +
+                       Metrics::label("code", getCECControlStr(
+                         (CEC::cec_user_control_code) code)),
+                       count);
+      }
+    }
+  }
+
+  metrics.family("cec_keyboard_key_queue_depth", "gauge",
+                 "Keys waiting to be sent to the input device.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    metrics.sample("cec_keyboard_key_queue_depth",
+                   Metrics::label("adapter", adapters[i]->id),
+                   adapters[i]->key_pipeline->queue().size());
+  }
 
+  metrics.family("cec_keyboard_key_queue_drained", "histogram",
+                 "Keys sent each time the dispatcher woke up.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    metrics.histogram("cec_keyboard_key_queue_drained",
+                      Metrics::label("adapter", adapters[i]->id),
+                      adapters[i]->key_pipeline->stats().drained_per_wakeup,
+                      drained_bounds, 1);
+  }
 
-std::string getCECControlStr(CEC::cec_user_control_code cec_control_code)
-{
-  for (std::map<std::string, CEC::cec_user_control_code>::iterator it =
-       cec_code_map.begin(); it != cec_code_map.end(); it++)
+  metrics.family("cec_keyboard_keys_dropped_total", "counter",
+                 "Keys dropped because the key queue was full.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    metrics.sample("cec_keyboard_keys_dropped_total",
+                   Metrics::label("adapter", adapters[i]->id),
+                   adapters[i]->key_pipeline->queue().overflows());
+  }
+
+  metrics.family("cec_keyboard_uinput_write_errors_total", "counter",
+                 "Failed writes to the input device.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    metrics.sample("cec_keyboard_uinput_write_errors_total",
+                   Metrics::label("adapter", adapters[i]->id),
+                   adapters[i]->key_pipeline->stats().write_errors);
+  }
+
+  metrics.family("cec_keyboard_keys_failed_total", "counter",
+                 "Keys lost in failed writes to the input device.");
+  for (i = 0; i < adapters.size(); i++)
+  {
+    metrics.sample("cec_keyboard_keys_failed_total",
+                   Metrics::label("adapter", adapters[i]->id),
+                   adapters[i]->key_pipeline->stats().failed_keys);
+  }
+
+  // adapters that haven't connected yet have no executor and are left out
+  std::vector<CECExecutor::CECExecutor*> executors(adapters.size());
+  bool any_executor = false;
+  for (i = 0; i < adapters.size(); i++)
+  {
+    executors[i] = adapters[i]->cec_executor;
+    any_executor |= (executors[i] != NULL);
+  }
+
+  if (any_executor)
+  {
+    std::map<std::string, Stats::CommandStats>::const_iterator it;
+
+    metrics.family("cec_keyboard_cec_commands_total", "counter",
+                   "CEC commands run on the bus.");
+    for (i = 0; i < adapters.size(); i++)
+    {
+      if (!executors[i])
+      {
+        continue;
+      }
+
+      const std::map<std::string, Stats::CommandStats>& command_stats =
+        executors[i]->commandStats();
+      std::string adapter = Metrics::label("adapter", adapters[i]->id);
+
+      for (it = command_stats.begin(); it != command_stats.end(); ++it)
+      {
+        metrics.sample("cec_keyboard_cec_commands_total",
+                       adapter + "," +
+                       Metrics::label("command", it->first) + "," +
+                       Metrics::label("result", "success"),
+                       it->second.succeeded);
+        metrics.sample("cec_keyboard_cec_commands_total",
+                       adapter + "," +
+                       Metrics::label("command", it->first) + "," +
+                       Metrics::label("result", "failure"),
+                       it->second.failed);
+      }
+    }
+
+    metrics.family("cec_keyboard_cec_command_latency_seconds", "histogram",
+                   "Time from a CEC command being received to it finishing "
+                   "on the bus.");
+    for (i = 0; i < adapters.size(); i++)
+    {
+      if (!executors[i])
+      {
+        continue;
+      }
+
+      const std::map<std::string, Stats::CommandStats>& command_stats =
+        executors[i]->commandStats();
+      std::string adapter = Metrics::label("adapter", adapters[i]->id);
+
+      for (it = command_stats.begin(); it != command_stats.end(); ++it)
+      {
+        metrics.histogram("cec_keyboard_cec_command_latency_seconds",
+                          adapter + "," +
+                          Metrics::label("command", it->first),
+                          it->second.latency_ns,
+                          Metrics::LATENCY_BOUNDS_NS, 1e9);
+      }
+    }
+
+    metrics.family("cec_keyboard_cec_queue_depth", "gauge",
+                   "CEC commands waiting to be run on the bus.");
+    for (i = 0; i < adapters.size(); i++)
+    {
+      if (executors[i])
+      {
+        metrics.sample("cec_keyboard_cec_queue_depth",
+                       Metrics::label("adapter", adapters[i]->id),
+                       executors[i]->pending());
+      }
+    }
+
+    metrics.family("cec_keyboard_cec_coalesced_total", "counter",
+                   "CEC commands merged into one already waiting.");
+    for (i = 0; i < adapters.size(); i++)
+    {
+      if (executors[i])
+      {
+        metrics.sample("cec_keyboard_cec_coalesced_total",
+                       Metrics::label("adapter", adapters[i]->id),
+                       executors[i]->stats().coalesced);
+      }
+    }
+
+    metrics.family("cec_keyboard_cec_superseded_total", "counter",
+                   "CEC commands replaced by a later one before being run.");
+    for (i = 0; i < adapters.size(); i++)
+    {
+      if (executors[i])
+      {
+        metrics.sample("cec_keyboard_cec_superseded_total",
+                       Metrics::label("adapter", adapters[i]->id),
+                       executors[i]->stats().superseded);
+      }
+    }
+  }
+
+  metrics.family("cec_keyboard_websocket_connections", "gauge",
+                 "Open websocket connections.");
+  metrics.sample("cec_keyboard_websocket_connections", "", ws_connections);
+
+  RateLimiter::RateLimiter* limiter = rate_limiter;
+  if (limiter)
   {
-    if (it->second == cec_control_code)
+    const char* targets[RateLimiter::TARGETS] = {"key", "cec"};
+
+    metrics.family("cec_keyboard_rejected_total", "counter",
+                   "Websocket commands refused by admission control.");
+    for (int i = 0; i < RateLimiter::TARGETS; i++)
     {
-      return it->first;
+      RateLimiter::Target target = (RateLimiter::Target) i;
+      metrics.sample("cec_keyboard_rejected_total",
+                     Metrics::label("target", targets[i]) + "," +
+                     Metrics::label("reason", "rate_limited"),
+                     limiter->rejected(target, RateLimiter::RATE_LIMITED));
+      metrics.sample("cec_keyboard_rejected_total",
+                     Metrics::label("target", targets[i]) + "," +
+                     Metrics::label("reason", "busy"),
+                     limiter->rejected(target, RateLimiter::BUSY));
     }
   }
 
-  return std::string("");
+  EventStream::EventStream* stream = event_stream;
+  if (stream)
+  {
+    metrics.family("cec_keyboard_event_subscribers", "gauge",
+                   "Websocket clients subscribed to events.");
+    metrics.sample("cec_keyboard_event_subscribers", "",
+                   stream->subscribers());
+
+    metrics.family("cec_keyboard_events_dropped_total", "counter",
+                   "Events skipped for clients that fell behind.");
+    metrics.sample("cec_keyboard_events_dropped_total", "",
+                   stream->dropped());
+  }
+
+  return metrics.text();
+}
+
+
+void sigintHandler(int signal)
+{
+  kill_main = true;
+  stopDispatch();
 }
 
 
-std::string getKeyStr(int input_key)
+void sighupHandler(int)
 {
-  for (std::map<std::string, int>::iterator it =
-       input_key_map.begin(); it != input_key_map.end(); it++)
+  if (config_reloader)
   {
-    if (it->second == input_key)
-    {
-      return it->first;
-    }
+    config_reloader->notify();
   }
-
-  return std::string("");
 }
 
 
@@ -657,14 +2972,50 @@ void dump_keymap(void)
 {
   YAML::Emitter out;
   out << YAML::BeginMap;
+
+  const std::vector<KeyTable::Macro>& macros = cec_key_table.macros();
+
+  if (!macros.empty())
+  {
+    out << YAML::Key << "macros";
+    out << YAML::BeginMap;
+
+    for (size_t i = 0; i < macros.size(); i++)
+    {
+      out << YAML::Key << macros[i].name;
+      out << YAML::Value << YAML::Flow << YAML::BeginSeq;
+
+      const KeyTable::Sequence& sequence = *macros[i].sequence;
+      for (size_t j = 0; j < sequence.size(); j++)
+      {
+        out << MacroRunner::stepToString(sequence[j]);
+      }
+
+      out << YAML::EndSeq;
+    }
+
+    out << YAML::EndMap;
+  }
+
   out << YAML::Key << "keymap";
   out << YAML::BeginMap;
 
-  for (std::map<CEC::cec_user_control_code, int>::iterator it =
-       cec_to_key.begin(); it != cec_to_key.end(); it++)
+  for (int i = 0; i < KeyTable::KeyTable::SIZE; i++)
   {
-    out << YAML::Key << getCECControlStr(it->first);
-    out << YAML::Value << getKeyStr(it->second);
+    CEC::cec_user_control_code cec_control_code =
+      (CEC::cec_user_control_code) i;
+    const KeyTable::Binding& binding = cec_key_table.binding(cec_control_code);
+
+    if (binding.macro >= 0)
+    {
+      out << YAML::Key << getCECControlStr(cec_control_code);
+      out << YAML::Value << "macro:" + macros[binding.macro].name;
+    }
+    else if (binding.chord.count > 0)
+    {
+      out << YAML::Key << getCECControlStr(cec_control_code);
+      out << YAML::Value << getChordStr(binding.chord);
+    }
   }
 
   out << YAML::EndMap;
@@ -0,0 +1,139 @@
+#include "cecadapter.h"
+
+#include <libcec/cecloader.h>
+
+namespace CECAdapter
+{
+  LibCECAdapter::LibCECAdapter(CEC::ICECAdapter* adapter) : adapter_(adapter)
+  {
+  }
+
+
+  LibCECAdapter::~LibCECAdapter(void)
+  {
+    UnloadLibCec(adapter_);
+  }
+
+
+  void LibCECAdapter::Close(void)
+  {
+    adapter_->Close();
+  }
+
+
+  bool LibCECAdapter::Transmit(const CEC::cec_command& data)
+  {
+    return adapter_->Transmit(data);
+  }
+
+
+  bool LibCECAdapter::PowerOnDevices(CEC::cec_logical_address address)
+  {
+    return adapter_->PowerOnDevices(address);
+  }
+
+
+  bool LibCECAdapter::StandbyDevices(CEC::cec_logical_address address)
+  {
+    return adapter_->StandbyDevices(address);
+  }
+
+
+  bool LibCECAdapter::SetActiveSource(void)
+  {
+    return adapter_->SetActiveSource();
+  }
+
+
+  bool LibCECAdapter::SetInactiveView(void)
+  {
+    return adapter_->SetInactiveView();
+  }
+
+
+  bool LibCECAdapter::SetStreamPath(uint16_t physical_address)
+  {
+    return adapter_->SetStreamPath(physical_address);
+  }
+
+
+  uint8_t LibCECAdapter::VolumeUp(bool send_release)
+  {
+    return adapter_->VolumeUp(send_release);
+  }
+
+
+  uint8_t LibCECAdapter::VolumeDown(bool send_release)
+  {
+    return adapter_->VolumeDown(send_release);
+  }
+
+
+  uint8_t LibCECAdapter::AudioToggleMute(void)
+  {
+    return adapter_->AudioToggleMute();
+  }
+
+
+  CEC::cec_logical_addresses LibCECAdapter::GetActiveDevices(void)
+  {
+    return adapter_->GetActiveDevices();
+  }
+
+
+  CEC::cec_logical_address LibCECAdapter::GetActiveSource(void)
+  {
+    return adapter_->GetActiveSource();
+  }
+
+
+  uint16_t LibCECAdapter::GetDevicePhysicalAddress(
+    CEC::cec_logical_address address)
+  {
+    return adapter_->GetDevicePhysicalAddress(address);
+  }
+
+
+  CEC::cec_power_status LibCECAdapter::GetDevicePowerStatus(
+    CEC::cec_logical_address address)
+  {
+    return adapter_->GetDevicePowerStatus(address);
+  }
+
+
+  uint32_t LibCECAdapter::GetDeviceVendorId(CEC::cec_logical_address address)
+  {
+    return adapter_->GetDeviceVendorId(address);
+  }
+
+
+  std::string LibCECAdapter::GetDeviceOSDName(
+    CEC::cec_logical_address address)
+  {
+    return adapter_->GetDeviceOSDName(address);
+  }
+
+
+  CEC::cec_command LibCECAdapter::CommandFromString(const char* command)
+  {
+    return adapter_->CommandFromString(command);
+  }
+
+
+  const char* LibCECAdapter::ToString(CEC::cec_logical_address address)
+  {
+    return adapter_->ToString(address);
+  }
+
+
+  const char* LibCECAdapter::ToString(CEC::cec_power_status status)
+  {
+    return adapter_->ToString(status);
+  }
+
+
+  const char* LibCECAdapter::VendorIdToString(uint32_t vendor_id)
+  {
+    return adapter_->VendorIdToString(vendor_id);
+  }
+};
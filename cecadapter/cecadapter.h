@@ -0,0 +1,88 @@
+#ifndef CECADAPTER_H
+#define CECADAPTER_H
+
+#include <stdint.h>
+
+#include <string>
+
+#include <libcec/cec.h>
+
+namespace CECAdapter
+{
+  // The part of CEC::ICECAdapter the daemon uses once an adapter is open,
+  // with the same names and meanings, so the bus can be provided by libcec
+  // or by something standing in for it. Events on the bus are reported
+  // through the ICECCallbacks of the configuration the adapter was created
+  // with.
+  class CECAdapter
+  {
+    public:
+      virtual ~CECAdapter() {}
+
+      virtual void Close(void) = 0;
+
+      virtual bool Transmit(const CEC::cec_command& data) = 0;
+      virtual bool PowerOnDevices(CEC::cec_logical_address address) = 0;
+      virtual bool StandbyDevices(CEC::cec_logical_address address) = 0;
+      virtual bool SetActiveSource(void) = 0;
+      virtual bool SetInactiveView(void) = 0;
+      virtual bool SetStreamPath(uint16_t physical_address) = 0;
+      virtual uint8_t VolumeUp(bool send_release) = 0;
+      virtual uint8_t VolumeDown(bool send_release) = 0;
+      virtual uint8_t AudioToggleMute(void) = 0;
+
+      virtual CEC::cec_logical_addresses GetActiveDevices(void) = 0;
+      virtual CEC::cec_logical_address GetActiveSource(void) = 0;
+      virtual uint16_t GetDevicePhysicalAddress(
+        CEC::cec_logical_address address) = 0;
+      virtual CEC::cec_power_status GetDevicePowerStatus(
+        CEC::cec_logical_address address) = 0;
+      virtual uint32_t GetDeviceVendorId(CEC::cec_logical_address address) = 0;
+      virtual std::string GetDeviceOSDName(
+        CEC::cec_logical_address address) = 0;
+
+      virtual CEC::cec_command CommandFromString(const char* command) = 0;
+      virtual const char* ToString(CEC::cec_logical_address address) = 0;
+      virtual const char* ToString(CEC::cec_power_status status) = 0;
+      virtual const char* VendorIdToString(uint32_t vendor_id) = 0;
+  };
+
+
+  // An adapter opened through libcec. Takes ownership of the libcec
+  // instance, which is unloaded when this is deleted.
+  class LibCECAdapter : public CECAdapter
+  {
+    public:
+      LibCECAdapter(CEC::ICECAdapter* adapter);
+      ~LibCECAdapter();
+
+      void Close(void);
+
+      bool Transmit(const CEC::cec_command& data);
+      bool PowerOnDevices(CEC::cec_logical_address address);
+      bool StandbyDevices(CEC::cec_logical_address address);
+      bool SetActiveSource(void);
+      bool SetInactiveView(void);
+      bool SetStreamPath(uint16_t physical_address);
+      uint8_t VolumeUp(bool send_release);
+      uint8_t VolumeDown(bool send_release);
+      uint8_t AudioToggleMute(void);
+
+      CEC::cec_logical_addresses GetActiveDevices(void);
+      CEC::cec_logical_address GetActiveSource(void);
+      uint16_t GetDevicePhysicalAddress(CEC::cec_logical_address address);
+      CEC::cec_power_status GetDevicePowerStatus(
+        CEC::cec_logical_address address);
+      uint32_t GetDeviceVendorId(CEC::cec_logical_address address);
+      std::string GetDeviceOSDName(CEC::cec_logical_address address);
+
+      CEC::cec_command CommandFromString(const char* command);
+      const char* ToString(CEC::cec_logical_address address);
+      const char* ToString(CEC::cec_power_status status);
+      const char* VendorIdToString(uint32_t vendor_id);
+
+    private:
+      CEC::ICECAdapter* adapter_;
+  };
+};
+#endif
@@ -0,0 +1,242 @@
+#include "ceccache.h"
+
+#include <chrono>
+
+#include "../stats/stats.h"
+
+namespace CECCache
+{
+  CECCache::CECCache(CECAdapter::CECAdapter* adapter, uint32_t ttl_ms) :
+    adapter_(adapter), ttl_ms_(ttl_ms),
+    active_source_(CEC::CECDEVICE_UNKNOWN), refreshed_ns_(0), stopped_(false)
+  {
+    for (int i = 0; i < DEVICES; i++)
+    {
+      devices_[i].present = false;
+      devices_[i].physical_address = CEC_INVALID_PHYSICAL_ADDRESS;
+      devices_[i].power_status = CEC::CEC_POWER_STATUS_UNKNOWN;
+      devices_[i].vendor_id = 0;
+      devices_[i].updated_ns = 0;
+    }
+
+    thread_ = std::thread(&CECCache::run, this);
+  }
+
+
+  CECCache::~CECCache(void)
+  {
+    stop();
+  }
+
+
+  void CECCache::stop(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+
+    stop_requested_.notify_all();
+
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+  }
+
+
+  // called with mutex_ held
+  Device* CECCache::lookup(CEC::cec_logical_address address)
+  {
+    // 15 is the broadcast or unregistered address, not a device
+    if ((address < 0) || (address >= CEC::CECDEVICE_BROADCAST))
+    {
+      return NULL;
+    }
+
+    return &devices_[address];
+  }
+
+
+  void CECCache::commandReceived(const CEC::cec_command& command)
+  {
+    const CEC::cec_datapacket& parameters = command.parameters;
+    uint64_t now_ns = Stats::monotonicNs();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // anything sent by a device shows that it is there
+    Device* device = lookup(command.initiator);
+    if (device)
+    {
+      device->present = true;
+      device->updated_ns = now_ns;
+    }
+
+    switch (command.opcode)
+    {
+      case CEC::CEC_OPCODE_REPORT_PHYSICAL_ADDRESS:
+        if (device && (parameters.size >= 2))
+        {
+          device->physical_address = (parameters[0] << 8) | parameters[1];
+        }
+        break;
+      case CEC::CEC_OPCODE_REPORT_POWER_STATUS:
+        if (device && (parameters.size >= 1))
+        {
+          device->power_status = (CEC::cec_power_status) parameters[0];
+        }
+        break;
+      case CEC::CEC_OPCODE_DEVICE_VENDOR_ID:
+        if (device && (parameters.size >= 3))
+        {
+          device->vendor_id = (parameters[0] << 16) | (parameters[1] << 8) |
+                              parameters[2];
+        }
+        break;
+      case CEC::CEC_OPCODE_SET_OSD_NAME:
+        if (device)
+        {
+          device->osd_name.assign((const char*) parameters.data,
+                                  parameters.size);
+        }
+        break;
+      case CEC::CEC_OPCODE_ACTIVE_SOURCE:
+        if (device)
+        {
+          // only a device that is on can become the active source
+          active_source_ = command.initiator;
+          device->power_status = CEC::CEC_POWER_STATUS_ON;
+
+          if (parameters.size >= 2)
+          {
+            device->physical_address = (parameters[0] << 8) | parameters[1];
+          }
+        }
+        break;
+      case CEC::CEC_OPCODE_INACTIVE_SOURCE:
+        if (active_source_ == command.initiator)
+        {
+          active_source_ = CEC::CECDEVICE_UNKNOWN;
+        }
+        break;
+      case CEC::CEC_OPCODE_STANDBY:
+        for (int i = 0; i < DEVICES; i++)
+        {
+          if ((command.destination == CEC::CECDEVICE_BROADCAST) ||
+              (command.destination == i))
+          {
+            devices_[i].power_status = CEC::CEC_POWER_STATUS_STANDBY;
+            devices_[i].updated_ns = now_ns;
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+
+  void CECCache::sourceActivated(CEC::cec_logical_address address,
+                                 bool activated)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (activated)
+    {
+      active_source_ = address;
+    }
+    else if (active_source_ == address)
+    {
+      active_source_ = CEC::CECDEVICE_UNKNOWN;
+    }
+  }
+
+
+  Device CECCache::device(CEC::cec_logical_address address)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Device* device = lookup(address);
+    if (!device)
+    {
+      Device absent = {false, CEC_INVALID_PHYSICAL_ADDRESS,
+                       CEC::CEC_POWER_STATUS_UNKNOWN, 0, "", 0};
+      return absent;
+    }
+
+    return *device;
+  }
+
+
+  CEC::cec_logical_address CECCache::activeSource(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_source_;
+  }
+
+
+  uint64_t CECCache::refreshedNs(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return refreshed_ns_;
+  }
+
+
+  void CECCache::refresh(void)
+  {
+    // every query here may be a bus transaction, so none of them are made
+    // with the lock held
+    CEC::cec_logical_addresses active_devices = adapter_->GetActiveDevices();
+
+    for (int i = 0; i < CEC::CECDEVICE_BROADCAST; i++)
+    {
+      CEC::cec_logical_address address = (CEC::cec_logical_address) i;
+      Device found = {false, CEC_INVALID_PHYSICAL_ADDRESS,
+                      CEC::CEC_POWER_STATUS_UNKNOWN, 0, "", 0};
+
+      if (active_devices.IsSet(address))
+      {
+        found.present = true;
+        found.physical_address = adapter_->GetDevicePhysicalAddress(address);
+        found.power_status = adapter_->GetDevicePowerStatus(address);
+        found.vendor_id = adapter_->GetDeviceVendorId(address);
+        found.osd_name = adapter_->GetDeviceOSDName(address);
+        found.updated_ns = Stats::monotonicNs();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (found.present || devices_[i].present)
+      {
+        devices_[i] = found;
+      }
+
+      if (stopped_)
+      {
+        return;
+      }
+    }
+
+    CEC::cec_logical_address active_source = adapter_->GetActiveSource();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_source_ = active_source;
+    refreshed_ns_ = Stats::monotonicNs();
+  }
+
+
+  void CECCache::run(void)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopped_)
+    {
+      lock.unlock();
+      refresh();
+      lock.lock();
+
+      stop_requested_.wait_for(lock, std::chrono::milliseconds(ttl_ms_),
+                               [this] { return stopped_; });
+    }
+  }
+};
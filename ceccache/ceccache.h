@@ -0,0 +1,70 @@
+#ifndef CECCACHE_H
+#define CECCACHE_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <libcec/cec.h>
+
+#include "../cecadapter/cecadapter.h"
+
+namespace CECCache
+{
+  // What is known about one logical address on the bus
+  struct Device
+  {
+    bool present;
+    uint16_t physical_address;
+    CEC::cec_power_status power_status;
+    uint32_t vendor_id;
+    std::string osd_name;
+    uint64_t updated_ns; // monotonic time anything about it was last learned
+  };
+
+
+  // In-process copy of the bus topology and device state, so that queries
+  // are answered without a bus transaction. It is kept current from the
+  // commands libcec reports and refreshed from the bus on a background
+  // thread every ttl_ms.
+  class CECCache
+  {
+    public:
+      static const int DEVICES = 16;
+
+      CECCache(CECAdapter::CECAdapter* adapter, uint32_t ttl_ms);
+      ~CECCache();
+
+      // called from the libcec callbacks
+      void commandReceived(const CEC::cec_command& command);
+      void sourceActivated(CEC::cec_logical_address address, bool activated);
+
+      Device device(CEC::cec_logical_address address);
+      CEC::cec_logical_address activeSource(void);
+      uint64_t refreshedNs(void);
+
+      // stops the background refresh, must be called before the adapter is
+      // closed
+      void stop(void);
+
+    private:
+      CECAdapter::CECAdapter* adapter_;
+      uint32_t ttl_ms_;
+
+      std::mutex mutex_;
+      std::condition_variable stop_requested_;
+      Device devices_[DEVICES];
+      CEC::cec_logical_address active_source_;
+      uint64_t refreshed_ns_;
+      bool stopped_;
+      std::thread thread_;
+
+      Device* lookup(CEC::cec_logical_address address);
+      void refresh(void);
+      void run(void);
+  };
+};
+#endif
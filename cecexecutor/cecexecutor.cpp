@@ -0,0 +1,346 @@
+#include "cecexecutor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../logger/logger.h"
+
+namespace CECExecutor
+{
+  static Result transmit(CECAdapter::CECAdapter* adapter,
+                         const std::string& args, int)
+  {
+    CEC::cec_command bytes = adapter->CommandFromString(args.c_str());
+    bytes.transmit_timeout = 0;
+    if (adapter->Transmit(bytes))
+    {
+      return {true, "Bytes sent (Warning: This function has not been tested)"};
+    }
+
+    return {false, "Byte transmission failed"};
+  }
+
+
+  static Result powerOn(CECAdapter::CECAdapter* adapter,
+                        const std::string& args, int)
+  {
+    int addr = -1;
+    if (sscanf(args.c_str(), "%x", &addr) == 1)
+    {
+      if ((addr >= 0) && (addr < 256))
+      {
+        if(adapter->PowerOnDevices((CEC::cec_logical_address) addr))
+        {
+          return {true, "Device powered on"};
+        }
+      }
+    }
+
+    return {false, "Failed to power device"};
+  }
+
+
+  static Result standby(CECAdapter::CECAdapter* adapter,
+                        const std::string& args, int)
+  {
+    int addr = -1;
+    if (sscanf(args.c_str(), "%x", &addr) == 1)
+    {
+      if ((addr >= 0) && (addr < 256))
+      {
+        if(adapter->StandbyDevices((CEC::cec_logical_address) addr))
+        {
+          return {true, "Device set to standby"};
+        }
+      }
+    }
+
+    return {false, "Failed to put device in standby"};
+  }
+
+
+  static Result setAddrActive(CECAdapter::CECAdapter* adapter,
+                              const std::string& args, int)
+  {
+    int addr = -1;
+    if (sscanf(args.c_str(), "%x", &addr) == 1)
+    {
+      Logger::log(Logger::LEVEL_DEBUG, "addr: %x", addr);
+      if ((addr >= 0) && (addr < CEC_INVALID_PHYSICAL_ADDRESS))
+      {
+        adapter->SetStreamPath((uint16_t) addr);
+        return {true, "Active path set"};
+      }
+    }
+
+    return {false, "Failed to set active path"};
+  }
+
+
+  static Result activate(CECAdapter::CECAdapter* adapter, const std::string&,
+                         int)
+  {
+    if (adapter->SetActiveSource())
+    {
+      return {true, "Device set as active source"};
+    }
+
+    return {false, "Failed to set device as active source"};
+  }
+
+
+  static Result deactivate(CECAdapter::CECAdapter* adapter, const std::string&,
+                           int)
+  {
+    if (adapter->SetInactiveView())
+    {
+      return {true, "Device set as inactive"};
+    }
+
+    return {false, "Failed to set device inactive view"};
+  }
+
+
+  static Result volume(CECAdapter::CECAdapter* adapter, const std::string&,
+                       int count)
+  {
+    // merged up and down steps can cancel each other out
+    if (count == 0)
+    {
+      return {true, "Volume unchanged"};
+    }
+
+    // the key is held down for every step and released after the last, so
+    // each extra step costs one message on the bus rather than two
+    for (int step = abs(count); step > 0; step--)
+    {
+      bool release = (step == 1);
+
+      if (!((count > 0) ? adapter->VolumeUp(release)
+                        : adapter->VolumeDown(release)))
+      {
+        return {false, "Failed change volume"};
+      }
+    }
+
+    if (count > 0)
+    {
+      return {true, "Volume increased"};
+    }
+
+    return {true, "Volume decreased"};
+  }
+
+
+  static Result mute(CECAdapter::CECAdapter* adapter, const std::string&, int)
+  {
+    if (adapter->AudioToggleMute())
+    {
+      return {true, "Mute toggled"};
+    }
+
+    return {false, "Failed to toggle mute"};
+  }
+
+
+  const std::unordered_map<std::string, CECExecutor::Command>
+    CECExecutor::commands_
+  {
+    {"transmit",        {&transmit,      PRIORITY_TRANSMIT, COALESCE_NONE, 1}},
+    {"on",              {&powerOn,       PRIORITY_POWER, COALESCE_NONE, 1}},
+    {"standby",         {&standby,       PRIORITY_POWER, COALESCE_NONE, 1}},
+    {"set_addr_active", {&setAddrActive, PRIORITY_ROUTING, COALESCE_LATEST, 1}},
+    {"activate",        {&activate,      PRIORITY_ROUTING, COALESCE_NONE, 1}},
+    {"deactivate",      {&deactivate,    PRIORITY_ROUTING, COALESCE_NONE, 1}},
+    {"volup",           {&volume,        PRIORITY_VOLUME, COALESCE_VOLUME, 1}},
+    {"voldown",         {&volume,        PRIORITY_VOLUME, COALESCE_VOLUME, -1}},
+    {"mute",            {&mute,          PRIORITY_VOLUME, COALESCE_NONE, 1}},
+  };
+
+
+  CECExecutor::CECExecutor(CECAdapter::CECAdapter* adapter) :
+    adapter_(adapter), pending_(0), stopped_(false)
+  {
+    // filled in before the thread starts, so it is never modified while
+    // being read
+    for (std::unordered_map<std::string, Command>::const_iterator it =
+           commands_.begin(); it != commands_.end(); ++it)
+    {
+      command_stats_[it->first];
+    }
+
+    thread_ = std::thread(&CECExecutor::run, this);
+  }
+
+
+  CECExecutor::~CECExecutor(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+
+    jobs_available_.notify_all();
+    thread_.join();
+  }
+
+
+  bool CECExecutor::isCommand(const std::string& command)
+  {
+    return commands_.find(command) != commands_.end();
+  }
+
+
+  bool CECExecutor::submit(const std::string& command,
+                           const std::string& args, Completion done)
+  {
+    std::unordered_map<std::string, Command>::const_iterator it =
+      commands_.find(command);
+
+    if (it == commands_.end())
+    {
+      return false;
+    }
+
+    const Command* next_command = &it->second;
+    Request request = {done, Stats::monotonicNs(),
+                       &command_stats_.find(command)->second};
+    std::vector<Request> superseded;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::deque<Job>& jobs = jobs_[next_command->priority];
+
+      stats_.commands++;
+      stats_.queue_depth.record(pending_);
+
+      // only merged into the newest volume command, so steps are never
+      // moved past a mute sent after them
+      if ((next_command->coalesce == COALESCE_VOLUME) && !jobs.empty() &&
+          (jobs.back().command->coalesce == COALESCE_VOLUME))
+      {
+        jobs.back().count += next_command->count;
+        jobs.back().requests.push_back(request);
+        stats_.coalesced++;
+        return true;
+      }
+
+      if (next_command->coalesce == COALESCE_LATEST)
+      {
+        for (std::deque<Job>::iterator job = jobs.begin(); job != jobs.end();
+             ++job)
+        {
+          if (job->command == next_command)
+          {
+            superseded = job->requests;
+            jobs.erase(job);
+            pending_--;
+            stats_.superseded++;
+            break;
+          }
+        }
+      }
+
+      jobs.push_back({next_command, args, next_command->count, {request}});
+      pending_++;
+    }
+
+    jobs_available_.notify_one();
+
+    Result result = {false, "Superseded by a later " + command};
+    for (size_t i = 0; i < superseded.size(); i++)
+    {
+      if (superseded[i].done)
+      {
+        superseded[i].done(result);
+      }
+    }
+
+    return true;
+  }
+
+
+  size_t CECExecutor::pending(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+  }
+
+
+  const Stats::CECStats& CECExecutor::stats(void) const
+  {
+    return stats_;
+  }
+
+
+  const std::map<std::string, Stats::CommandStats>&
+    CECExecutor::commandStats(void) const
+  {
+    return command_stats_;
+  }
+
+
+  void CECExecutor::run(void)
+  {
+    for (;;)
+    {
+      Job job;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobs_available_.wait(lock,
+                             [this] { return stopped_ || (pending_ > 0); });
+
+        // commands still queued at shutdown are dropped
+        if (stopped_)
+        {
+          return;
+        }
+
+        for (int priority = 0; priority < PRIORITIES; priority++)
+        {
+          if (!jobs_[priority].empty())
+          {
+            job = std::move(jobs_[priority].front());
+            jobs_[priority].pop_front();
+            break;
+          }
+        }
+
+        pending_--;
+      }
+
+      uint64_t started_ns = Stats::monotonicNs();
+      Result result = job.command->handler(adapter_, job.args, job.count);
+      uint64_t finished_ns = Stats::monotonicNs();
+
+      // the bus operation is timed from the first request merged into it
+      stats_.transmit_ns.record(finished_ns - started_ns);
+      stats_.latency_ns.record(finished_ns - job.requests[0].submitted_ns);
+      if (!result.success)
+      {
+        stats_.failed++;
+      }
+
+      for (size_t i = 0; i < job.requests.size(); i++)
+      {
+        const Request& request = job.requests[i];
+
+        request.stats->latency_ns.record(finished_ns - request.submitted_ns);
+        if (result.success)
+        {
+          request.stats->succeeded++;
+        }
+        else
+        {
+          request.stats->failed++;
+        }
+
+        if (request.done)
+        {
+          request.done(result);
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,125 @@
+#ifndef CECEXECUTOR_H
+#define CECEXECUTOR_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <libcec/cec.h>
+
+#include "../cecadapter/cecadapter.h"
+#include "../stats/stats.h"
+
+namespace CECExecutor
+{
+  struct Result
+  {
+    bool success;
+    std::string message;
+  };
+
+  typedef std::function<void(const Result&)> Completion;
+
+  // waiting commands are run highest priority first, in the order they were
+  // submitted within a priority
+  enum Priority
+  {
+    PRIORITY_POWER,
+    PRIORITY_ROUTING,
+    PRIORITY_TRANSMIT,
+    PRIORITY_VOLUME,
+    PRIORITIES
+  };
+
+
+  // Runs CEC commands on a dedicated thread so that slow bus operations
+  // don't hold up the thread that received the command. Completions are
+  // called on the executor thread once the bus operation has finished, or
+  // on the submitting thread for a command superseded before it was sent.
+  //
+  // The bus carries a few hundred bits per second, so commands that would
+  // be redundant by the time they reach it are merged while they wait:
+  // volume steps add up into a single held key press, and a stream path
+  // change replaces any that has not been sent yet.
+  class CECExecutor
+  {
+    public:
+      CECExecutor(CECAdapter::CECAdapter* adapter);
+      ~CECExecutor();
+
+      static bool isCommand(const std::string& command);
+
+      // returns false, without calling done, if the command is unknown
+      bool submit(const std::string& command, const std::string& args,
+                  Completion done);
+
+      size_t pending(void);
+
+      const Stats::CECStats& stats(void) const;
+
+      // by command name, every command has an entry
+      const std::map<std::string, Stats::CommandStats>&
+        commandStats(void) const;
+
+    private:
+      // count is the number of steps for a merged volume command, negative
+      // for down, and 1 for everything else
+      typedef Result (*Handler)(CECAdapter::CECAdapter* adapter,
+                                const std::string& args, int count);
+
+      enum Coalesce
+      {
+        COALESCE_NONE,
+        COALESCE_VOLUME, // steps are added to a waiting volume command
+        COALESCE_LATEST  // replaces a waiting command of the same name
+      };
+
+      struct Command
+      {
+        Handler handler;
+        Priority priority;
+        Coalesce coalesce;
+        int count;
+      };
+
+      // one submission, counted against its own command's stats even when
+      // merged into a job for another, e.g. a voldown into a volup
+      struct Request
+      {
+        Completion done;
+        uint64_t submitted_ns;
+        Stats::CommandStats* stats;
+      };
+
+      struct Job
+      {
+        const Command* command;
+        std::string args;
+        int count;
+        std::vector<Request> requests; // one for each request merged in
+      };
+
+      static const std::unordered_map<std::string, Command> commands_;
+
+      CECAdapter::CECAdapter* adapter_;
+      std::mutex mutex_;
+      std::condition_variable jobs_available_;
+      std::deque<Job> jobs_[PRIORITIES];
+      size_t pending_;
+      bool stopped_;
+      Stats::CECStats stats_;
+      std::map<std::string, Stats::CommandStats> command_stats_;
+      std::thread thread_;
+
+      void run(void);
+  };
+};
+#endif
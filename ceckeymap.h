@@ -1,11 +1,36 @@
 #ifndef STRINGMAPPING_H
 #define STRINGMAPPING_H
-#include <map>
+#include <cstddef>
+#include <string>
 #include <linux/uinput.h>
 #include "libcec/cectypes.h"
+#include "inputdevice/inputdevice.h"
+
+// All tables in this file are constexpr so they are laid out at compile time
+// and need no allocation at startup. Name tables are sorted by name for
+// binary search, and the reverse indexes below give O(1) code to name
+// lookups.
+
+struct CECKeyPair
+{
+  CEC::cec_user_control_code cec_control_code;
+  int input_key;
+};
+
+struct InputKeyName
+{
+  const char* name;
+  int input_key;
+};
+
+struct CECCodeName
+{
+  const char* name;
+  CEC::cec_user_control_code cec_control_code;
+};
 
 // Default mapping from CEC codes to keys
-std::map<CEC::cec_user_control_code, int> cec_to_key
+constexpr CECKeyPair default_cec_to_key[]
 {
   {CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT,              KEY_ENTER},
   {CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UP,                  KEY_UP},
@@ -47,12 +72,12 @@ std::map<CEC::cec_user_control_code, int> cec_to_key
 };
 
 
-// keys mapped from string to int in linux/uinput.h
-std::map<std::string, int> input_key_map
+// keys mapped from string to int in linux/uinput.h, sorted by name
+constexpr InputKeyName input_key_names[]
 {
-  {"KEY_RESERVED", KEY_RESERVED},
-  {"KEY_ESC", KEY_ESC},
+  {"KEY_0", KEY_0},
   {"KEY_1", KEY_1},
+  {"KEY_102ND", KEY_102ND},
   {"KEY_2", KEY_2},
   {"KEY_3", KEY_3},
   {"KEY_4", KEY_4},
@@ -61,177 +86,61 @@ std::map<std::string, int> input_key_map
   {"KEY_7", KEY_7},
   {"KEY_8", KEY_8},
   {"KEY_9", KEY_9},
-  {"KEY_0", KEY_0},
-  {"KEY_MINUS", KEY_MINUS},
-  {"KEY_EQUAL", KEY_EQUAL},
-  {"KEY_BACKSPACE", KEY_BACKSPACE},
-  {"KEY_TAB", KEY_TAB},
-  {"KEY_Q", KEY_Q},
-  {"KEY_W", KEY_W},
-  {"KEY_E", KEY_E},
-  {"KEY_R", KEY_R},
-  {"KEY_T", KEY_T},
-  {"KEY_Y", KEY_Y},
-  {"KEY_U", KEY_U},
-  {"KEY_I", KEY_I},
-  {"KEY_O", KEY_O},
-  {"KEY_P", KEY_P},
-  {"KEY_LEFTBRACE", KEY_LEFTBRACE},
-  {"KEY_RIGHTBRACE", KEY_RIGHTBRACE},
-  {"KEY_ENTER", KEY_ENTER},
-  {"KEY_LEFTCTRL", KEY_LEFTCTRL},
   {"KEY_A", KEY_A},
-  {"KEY_S", KEY_S},
-  {"KEY_D", KEY_D},
-  {"KEY_F", KEY_F},
-  {"KEY_G", KEY_G},
-  {"KEY_H", KEY_H},
-  {"KEY_J", KEY_J},
-  {"KEY_K", KEY_K},
-  {"KEY_L", KEY_L},
-  {"KEY_SEMICOLON", KEY_SEMICOLON},
+  {"KEY_AGAIN", KEY_AGAIN},
+  {"KEY_ALTERASE", KEY_ALTERASE},
   {"KEY_APOSTROPHE", KEY_APOSTROPHE},
-  {"KEY_GRAVE", KEY_GRAVE},
-  {"KEY_LEFTSHIFT", KEY_LEFTSHIFT},
+  {"KEY_B", KEY_B},
+  {"KEY_BACK", KEY_BACK},
   {"KEY_BACKSLASH", KEY_BACKSLASH},
-  {"KEY_Z", KEY_Z},
-  {"KEY_X", KEY_X},
+  {"KEY_BACKSPACE", KEY_BACKSPACE},
+  {"KEY_BASSBOOST", KEY_BASSBOOST},
+  {"KEY_BATTERY", KEY_BATTERY},
+  {"KEY_BLUETOOTH", KEY_BLUETOOTH},
+  {"KEY_BOOKMARKS", KEY_BOOKMARKS},
+  {"KEY_BRIGHTNESSDOWN", KEY_BRIGHTNESSDOWN},
+  {"KEY_BRIGHTNESSUP", KEY_BRIGHTNESSUP},
+  {"KEY_BRIGHTNESS_AUTO", KEY_BRIGHTNESS_AUTO},
+  {"KEY_BRIGHTNESS_CYCLE", KEY_BRIGHTNESS_CYCLE},
   {"KEY_C", KEY_C},
-  {"KEY_V", KEY_V},
-  {"KEY_B", KEY_B},
-  {"KEY_N", KEY_N},
-  {"KEY_M", KEY_M},
-  {"KEY_COMMA", KEY_COMMA},
-  {"KEY_DOT", KEY_DOT},
-  {"KEY_SLASH", KEY_SLASH},
-  {"KEY_RIGHTSHIFT", KEY_RIGHTSHIFT},
-  {"KEY_KPASTERISK", KEY_KPASTERISK},
-  {"KEY_LEFTALT", KEY_LEFTALT},
-  {"KEY_SPACE", KEY_SPACE},
+  {"KEY_CALC", KEY_CALC},
+  {"KEY_CAMERA", KEY_CAMERA},
+  {"KEY_CANCEL", KEY_CANCEL},
   {"KEY_CAPSLOCK", KEY_CAPSLOCK},
-  {"KEY_F1", KEY_F1},
-  {"KEY_F2", KEY_F2},
-  {"KEY_F3", KEY_F3},
-  {"KEY_F4", KEY_F4},
-  {"KEY_F5", KEY_F5},
-  {"KEY_F6", KEY_F6},
-  {"KEY_F7", KEY_F7},
-  {"KEY_F8", KEY_F8},
-  {"KEY_F9", KEY_F9},
-  {"KEY_F10", KEY_F10},
-  {"KEY_NUMLOCK", KEY_NUMLOCK},
-  {"KEY_SCROLLLOCK", KEY_SCROLLLOCK},
-  {"KEY_KP7", KEY_KP7},
-  {"KEY_KP8", KEY_KP8},
-  {"KEY_KP9", KEY_KP9},
-  {"KEY_KPMINUS", KEY_KPMINUS},
-  {"KEY_KP4", KEY_KP4},
-  {"KEY_KP5", KEY_KP5},
-  {"KEY_KP6", KEY_KP6},
-  {"KEY_KPPLUS", KEY_KPPLUS},
-  {"KEY_KP1", KEY_KP1},
-  {"KEY_KP2", KEY_KP2},
-  {"KEY_KP3", KEY_KP3},
-  {"KEY_KP0", KEY_KP0},
-  {"KEY_KPDOT", KEY_KPDOT},
-  {"KEY_ZENKAKUHANKAKU", KEY_ZENKAKUHANKAKU},
-  {"KEY_102ND", KEY_102ND},
-  {"KEY_F11", KEY_F11},
-  {"KEY_F12", KEY_F12},
-  {"KEY_RO", KEY_RO},
-  {"KEY_KATAKANA", KEY_KATAKANA},
-  {"KEY_HIRAGANA", KEY_HIRAGANA},
-  {"KEY_HENKAN", KEY_HENKAN},
-  {"KEY_KATAKANAHIRAGANA", KEY_KATAKANAHIRAGANA},
-  {"KEY_MUHENKAN", KEY_MUHENKAN},
-  {"KEY_KPJPCOMMA", KEY_KPJPCOMMA},
-  {"KEY_KPENTER", KEY_KPENTER},
-  {"KEY_RIGHTCTRL", KEY_RIGHTCTRL},
-  {"KEY_KPSLASH", KEY_KPSLASH},
-  {"KEY_SYSRQ", KEY_SYSRQ},
-  {"KEY_RIGHTALT", KEY_RIGHTALT},
-  {"KEY_LINEFEED", KEY_LINEFEED},
-  {"KEY_HOME", KEY_HOME},
-  {"KEY_UP", KEY_UP},
-  {"KEY_PAGEUP", KEY_PAGEUP},
-  {"KEY_LEFT", KEY_LEFT},
-  {"KEY_RIGHT", KEY_RIGHT},
-  {"KEY_END", KEY_END},
-  {"KEY_DOWN", KEY_DOWN},
-  {"KEY_PAGEDOWN", KEY_PAGEDOWN},
-  {"KEY_INSERT", KEY_INSERT},
-  {"KEY_DELETE", KEY_DELETE},
-  {"KEY_MACRO", KEY_MACRO},
-  {"KEY_MUTE", KEY_MUTE},
-  {"KEY_VOLUMEDOWN", KEY_VOLUMEDOWN},
-  {"KEY_VOLUMEUP", KEY_VOLUMEUP},
-  {"KEY_POWER", KEY_POWER},
-  {"KEY_KPEQUAL", KEY_KPEQUAL},
-  {"KEY_KPPLUSMINUS", KEY_KPPLUSMINUS},
-  {"KEY_PAUSE", KEY_PAUSE},
-  {"KEY_SCALE", KEY_SCALE},
-  {"KEY_KPCOMMA", KEY_KPCOMMA},
-  {"KEY_HANGEUL", KEY_HANGEUL},
-  {"KEY_HANJA", KEY_HANJA},
-  {"KEY_YEN", KEY_YEN},
-  {"KEY_LEFTMETA", KEY_LEFTMETA},
-  {"KEY_RIGHTMETA", KEY_RIGHTMETA},
+  {"KEY_CHAT", KEY_CHAT},
+  {"KEY_CLOSE", KEY_CLOSE},
+  {"KEY_CLOSECD", KEY_CLOSECD},
+  {"KEY_COMMA", KEY_COMMA},
   {"KEY_COMPOSE", KEY_COMPOSE},
-  {"KEY_STOP", KEY_STOP},
-  {"KEY_AGAIN", KEY_AGAIN},
-  {"KEY_PROPS", KEY_PROPS},
-  {"KEY_UNDO", KEY_UNDO},
-  {"KEY_FRONT", KEY_FRONT},
+  {"KEY_COMPUTER", KEY_COMPUTER},
+  {"KEY_CONFIG", KEY_CONFIG},
+  {"KEY_CONNECT", KEY_CONNECT},
   {"KEY_COPY", KEY_COPY},
-  {"KEY_OPEN", KEY_OPEN},
-  {"KEY_PASTE", KEY_PASTE},
-  {"KEY_FIND", KEY_FIND},
   {"KEY_CUT", KEY_CUT},
-  {"KEY_HELP", KEY_HELP},
-  {"KEY_MENU", KEY_MENU},
-  {"KEY_CALC", KEY_CALC},
-  {"KEY_SETUP", KEY_SETUP},
-  {"KEY_SLEEP", KEY_SLEEP},
-  {"KEY_WAKEUP", KEY_WAKEUP},
-  {"KEY_FILE", KEY_FILE},
-  {"KEY_SENDFILE", KEY_SENDFILE},
-  {"KEY_DELETEFILE", KEY_DELETEFILE},
-  {"KEY_XFER", KEY_XFER},
-  {"KEY_PROG1", KEY_PROG1},
-  {"KEY_PROG2", KEY_PROG2},
-  {"KEY_WWW", KEY_WWW},
-  {"KEY_MSDOS", KEY_MSDOS},
-  {"KEY_SCREENLOCK", KEY_SCREENLOCK},
-  {"KEY_ROTATE_DISPLAY", KEY_ROTATE_DISPLAY},
   {"KEY_CYCLEWINDOWS", KEY_CYCLEWINDOWS},
-  {"KEY_MAIL", KEY_MAIL},
-  {"KEY_BOOKMARKS", KEY_BOOKMARKS},
-  {"KEY_COMPUTER", KEY_COMPUTER},
-  {"KEY_BACK", KEY_BACK},
-  {"KEY_FORWARD", KEY_FORWARD},
-  {"KEY_CLOSECD", KEY_CLOSECD},
+  {"KEY_D", KEY_D},
+  {"KEY_DASHBOARD", KEY_DASHBOARD},
+  {"KEY_DELETE", KEY_DELETE},
+  {"KEY_DELETEFILE", KEY_DELETEFILE},
+  {"KEY_DISPLAY_OFF", KEY_DISPLAY_OFF},
+  {"KEY_DOCUMENTS", KEY_DOCUMENTS},
+  {"KEY_DOT", KEY_DOT},
+  {"KEY_DOWN", KEY_DOWN},
+  {"KEY_E", KEY_E},
+  {"KEY_EDIT", KEY_EDIT},
   {"KEY_EJECTCD", KEY_EJECTCD},
   {"KEY_EJECTCLOSECD", KEY_EJECTCLOSECD},
-  {"KEY_NEXTSONG", KEY_NEXTSONG},
-  {"KEY_PLAYPAUSE", KEY_PLAYPAUSE},
-  {"KEY_PREVIOUSSONG", KEY_PREVIOUSSONG},
-  {"KEY_STOPCD", KEY_STOPCD},
-  {"KEY_RECORD", KEY_RECORD},
-  {"KEY_REWIND", KEY_REWIND},
-  {"KEY_PHONE", KEY_PHONE},
-  {"KEY_ISO", KEY_ISO},
-  {"KEY_CONFIG", KEY_CONFIG},
-  {"KEY_HOMEPAGE", KEY_HOMEPAGE},
-  {"KEY_REFRESH", KEY_REFRESH},
+  {"KEY_EMAIL", KEY_EMAIL},
+  {"KEY_END", KEY_END},
+  {"KEY_ENTER", KEY_ENTER},
+  {"KEY_EQUAL", KEY_EQUAL},
+  {"KEY_ESC", KEY_ESC},
   {"KEY_EXIT", KEY_EXIT},
-  {"KEY_MOVE", KEY_MOVE},
-  {"KEY_EDIT", KEY_EDIT},
-  {"KEY_SCROLLUP", KEY_SCROLLUP},
-  {"KEY_SCROLLDOWN", KEY_SCROLLDOWN},
-  {"KEY_KPLEFTPAREN", KEY_KPLEFTPAREN},
-  {"KEY_KPRIGHTPAREN", KEY_KPRIGHTPAREN},
-  {"KEY_NEW", KEY_NEW},
-  {"KEY_REDO", KEY_REDO},
+  {"KEY_F", KEY_F},
+  {"KEY_F1", KEY_F1},
+  {"KEY_F10", KEY_F10},
+  {"KEY_F11", KEY_F11},
+  {"KEY_F12", KEY_F12},
   {"KEY_F13", KEY_F13},
   {"KEY_F14", KEY_F14},
   {"KEY_F15", KEY_F15},
@@ -239,87 +148,223 @@ std::map<std::string, int> input_key_map
   {"KEY_F17", KEY_F17},
   {"KEY_F18", KEY_F18},
   {"KEY_F19", KEY_F19},
+  {"KEY_F2", KEY_F2},
   {"KEY_F20", KEY_F20},
   {"KEY_F21", KEY_F21},
   {"KEY_F22", KEY_F22},
   {"KEY_F23", KEY_F23},
   {"KEY_F24", KEY_F24},
-  {"KEY_PLAYCD", KEY_PLAYCD},
-  {"KEY_PAUSECD", KEY_PAUSECD},
-  {"KEY_PROG3", KEY_PROG3},
-  {"KEY_PROG4", KEY_PROG4},
-  {"KEY_DASHBOARD", KEY_DASHBOARD},
-  {"KEY_SUSPEND", KEY_SUSPEND},
-  {"KEY_CLOSE", KEY_CLOSE},
-  {"KEY_PLAY", KEY_PLAY},
+  {"KEY_F3", KEY_F3},
+  {"KEY_F4", KEY_F4},
+  {"KEY_F5", KEY_F5},
+  {"KEY_F6", KEY_F6},
+  {"KEY_F7", KEY_F7},
+  {"KEY_F8", KEY_F8},
+  {"KEY_F9", KEY_F9},
   {"KEY_FASTFORWARD", KEY_FASTFORWARD},
-  {"KEY_BASSBOOST", KEY_BASSBOOST},
-  {"KEY_PRINT", KEY_PRINT},
-  {"KEY_HP", KEY_HP},
-  {"KEY_CAMERA", KEY_CAMERA},
-  {"KEY_SOUND", KEY_SOUND},
-  {"KEY_QUESTION", KEY_QUESTION},
-  {"KEY_EMAIL", KEY_EMAIL},
-  {"KEY_CHAT", KEY_CHAT},
-  {"KEY_SEARCH", KEY_SEARCH},
-  {"KEY_CONNECT", KEY_CONNECT},
+  {"KEY_FILE", KEY_FILE},
   {"KEY_FINANCE", KEY_FINANCE},
-  {"KEY_SPORT", KEY_SPORT},
-  {"KEY_SHOP", KEY_SHOP},
-  {"KEY_ALTERASE", KEY_ALTERASE},
-  {"KEY_CANCEL", KEY_CANCEL},
-  {"KEY_BRIGHTNESSDOWN", KEY_BRIGHTNESSDOWN},
-  {"KEY_BRIGHTNESSUP", KEY_BRIGHTNESSUP},
-  {"KEY_MEDIA", KEY_MEDIA},
-  {"KEY_SWITCHVIDEOMODE", KEY_SWITCHVIDEOMODE},
-  {"KEY_KBDILLUMTOGGLE", KEY_KBDILLUMTOGGLE},
-  {"KEY_KBDILLUMDOWN", KEY_KBDILLUMDOWN},
-  {"KEY_KBDILLUMUP", KEY_KBDILLUMUP},
-  {"KEY_SEND", KEY_SEND},
-  {"KEY_REPLY", KEY_REPLY},
+  {"KEY_FIND", KEY_FIND},
+  {"KEY_FORWARD", KEY_FORWARD},
   {"KEY_FORWARDMAIL", KEY_FORWARDMAIL},
+  {"KEY_FRONT", KEY_FRONT},
+  {"KEY_G", KEY_G},
+  {"KEY_GRAVE", KEY_GRAVE},
+  {"KEY_H", KEY_H},
+  {"KEY_HANGEUL", KEY_HANGEUL},
+  {"KEY_HANJA", KEY_HANJA},
+  {"KEY_HELP", KEY_HELP},
+  {"KEY_HENKAN", KEY_HENKAN},
+  {"KEY_HIRAGANA", KEY_HIRAGANA},
+  {"KEY_HOME", KEY_HOME},
+  {"KEY_HOMEPAGE", KEY_HOMEPAGE},
+  {"KEY_HP", KEY_HP},
+  {"KEY_I", KEY_I},
+  {"KEY_INSERT", KEY_INSERT},
+  {"KEY_ISO", KEY_ISO},
+  {"KEY_J", KEY_J},
+  {"KEY_K", KEY_K},
+  {"KEY_KATAKANA", KEY_KATAKANA},
+  {"KEY_KATAKANAHIRAGANA", KEY_KATAKANAHIRAGANA},
+  {"KEY_KBDILLUMDOWN", KEY_KBDILLUMDOWN},
+  {"KEY_KBDILLUMTOGGLE", KEY_KBDILLUMTOGGLE},
+  {"KEY_KBDILLUMUP", KEY_KBDILLUMUP},
+  {"KEY_KP0", KEY_KP0},
+  {"KEY_KP1", KEY_KP1},
+  {"KEY_KP2", KEY_KP2},
+  {"KEY_KP3", KEY_KP3},
+  {"KEY_KP4", KEY_KP4},
+  {"KEY_KP5", KEY_KP5},
+  {"KEY_KP6", KEY_KP6},
+  {"KEY_KP7", KEY_KP7},
+  {"KEY_KP8", KEY_KP8},
+  {"KEY_KP9", KEY_KP9},
+  {"KEY_KPASTERISK", KEY_KPASTERISK},
+  {"KEY_KPCOMMA", KEY_KPCOMMA},
+  {"KEY_KPDOT", KEY_KPDOT},
+  {"KEY_KPENTER", KEY_KPENTER},
+  {"KEY_KPEQUAL", KEY_KPEQUAL},
+  {"KEY_KPJPCOMMA", KEY_KPJPCOMMA},
+  {"KEY_KPLEFTPAREN", KEY_KPLEFTPAREN},
+  {"KEY_KPMINUS", KEY_KPMINUS},
+  {"KEY_KPPLUS", KEY_KPPLUS},
+  {"KEY_KPPLUSMINUS", KEY_KPPLUSMINUS},
+  {"KEY_KPRIGHTPAREN", KEY_KPRIGHTPAREN},
+  {"KEY_KPSLASH", KEY_KPSLASH},
+  {"KEY_L", KEY_L},
+  {"KEY_LEFT", KEY_LEFT},
+  {"KEY_LEFTALT", KEY_LEFTALT},
+  {"KEY_LEFTBRACE", KEY_LEFTBRACE},
+  {"KEY_LEFTCTRL", KEY_LEFTCTRL},
+  {"KEY_LEFTMETA", KEY_LEFTMETA},
+  {"KEY_LEFTSHIFT", KEY_LEFTSHIFT},
+  {"KEY_LINEFEED", KEY_LINEFEED},
+  {"KEY_M", KEY_M},
+  {"KEY_MACRO", KEY_MACRO},
+  {"KEY_MAIL", KEY_MAIL},
+  {"KEY_MEDIA", KEY_MEDIA},
+  {"KEY_MENU", KEY_MENU},
+  {"KEY_MICMUTE", KEY_MICMUTE},
+  {"KEY_MINUS", KEY_MINUS},
+  {"KEY_MOVE", KEY_MOVE},
+  {"KEY_MSDOS", KEY_MSDOS},
+  {"KEY_MUHENKAN", KEY_MUHENKAN},
+  {"KEY_MUTE", KEY_MUTE},
+  {"KEY_N", KEY_N},
+  {"KEY_NEW", KEY_NEW},
+  {"KEY_NEXTSONG", KEY_NEXTSONG},
+  {"KEY_NUMLOCK", KEY_NUMLOCK},
+  {"KEY_O", KEY_O},
+  {"KEY_OPEN", KEY_OPEN},
+  {"KEY_P", KEY_P},
+  {"KEY_PAGEDOWN", KEY_PAGEDOWN},
+  {"KEY_PAGEUP", KEY_PAGEUP},
+  {"KEY_PASTE", KEY_PASTE},
+  {"KEY_PAUSE", KEY_PAUSE},
+  {"KEY_PAUSECD", KEY_PAUSECD},
+  {"KEY_PHONE", KEY_PHONE},
+  {"KEY_PLAY", KEY_PLAY},
+  {"KEY_PLAYCD", KEY_PLAYCD},
+  {"KEY_PLAYPAUSE", KEY_PLAYPAUSE},
+  {"KEY_POWER", KEY_POWER},
+  {"KEY_PREVIOUSSONG", KEY_PREVIOUSSONG},
+  {"KEY_PRINT", KEY_PRINT},
+  {"KEY_PROG1", KEY_PROG1},
+  {"KEY_PROG2", KEY_PROG2},
+  {"KEY_PROG3", KEY_PROG3},
+  {"KEY_PROG4", KEY_PROG4},
+  {"KEY_PROPS", KEY_PROPS},
+  {"KEY_Q", KEY_Q},
+  {"KEY_QUESTION", KEY_QUESTION},
+  {"KEY_R", KEY_R},
+  {"KEY_RECORD", KEY_RECORD},
+  {"KEY_REDO", KEY_REDO},
+  {"KEY_REFRESH", KEY_REFRESH},
+  {"KEY_REPLY", KEY_REPLY},
+  {"KEY_RESERVED", KEY_RESERVED},
+  {"KEY_REWIND", KEY_REWIND},
+  {"KEY_RFKILL", KEY_RFKILL},
+  {"KEY_RIGHT", KEY_RIGHT},
+  {"KEY_RIGHTALT", KEY_RIGHTALT},
+  {"KEY_RIGHTBRACE", KEY_RIGHTBRACE},
+  {"KEY_RIGHTCTRL", KEY_RIGHTCTRL},
+  {"KEY_RIGHTMETA", KEY_RIGHTMETA},
+  {"KEY_RIGHTSHIFT", KEY_RIGHTSHIFT},
+  {"KEY_RO", KEY_RO},
+  {"KEY_ROTATE_DISPLAY", KEY_ROTATE_DISPLAY},
+  {"KEY_S", KEY_S},
   {"KEY_SAVE", KEY_SAVE},
-  {"KEY_DOCUMENTS", KEY_DOCUMENTS},
-  {"KEY_BATTERY", KEY_BATTERY},
-  {"KEY_BLUETOOTH", KEY_BLUETOOTH},
-  {"KEY_WLAN", KEY_WLAN},
-  {"KEY_UWB", KEY_UWB},
+  {"KEY_SCALE", KEY_SCALE},
+  {"KEY_SCREENLOCK", KEY_SCREENLOCK},
+  {"KEY_SCROLLDOWN", KEY_SCROLLDOWN},
+  {"KEY_SCROLLLOCK", KEY_SCROLLLOCK},
+  {"KEY_SCROLLUP", KEY_SCROLLUP},
+  {"KEY_SEARCH", KEY_SEARCH},
+  {"KEY_SEMICOLON", KEY_SEMICOLON},
+  {"KEY_SEND", KEY_SEND},
+  {"KEY_SENDFILE", KEY_SENDFILE},
+  {"KEY_SETUP", KEY_SETUP},
+  {"KEY_SHOP", KEY_SHOP},
+  {"KEY_SLASH", KEY_SLASH},
+  {"KEY_SLEEP", KEY_SLEEP},
+  {"KEY_SOUND", KEY_SOUND},
+  {"KEY_SPACE", KEY_SPACE},
+  {"KEY_SPORT", KEY_SPORT},
+  {"KEY_STOP", KEY_STOP},
+  {"KEY_STOPCD", KEY_STOPCD},
+  {"KEY_SUSPEND", KEY_SUSPEND},
+  {"KEY_SWITCHVIDEOMODE", KEY_SWITCHVIDEOMODE},
+  {"KEY_SYSRQ", KEY_SYSRQ},
+  {"KEY_T", KEY_T},
+  {"KEY_TAB", KEY_TAB},
+  {"KEY_U", KEY_U},
+  {"KEY_UNDO", KEY_UNDO},
   {"KEY_UNKNOWN", KEY_UNKNOWN},
+  {"KEY_UP", KEY_UP},
+  {"KEY_UWB", KEY_UWB},
+  {"KEY_V", KEY_V},
   {"KEY_VIDEO_NEXT", KEY_VIDEO_NEXT},
   {"KEY_VIDEO_PREV", KEY_VIDEO_PREV},
-  {"KEY_BRIGHTNESS_CYCLE", KEY_BRIGHTNESS_CYCLE},
-  {"KEY_BRIGHTNESS_AUTO", KEY_BRIGHTNESS_AUTO},
-  {"KEY_DISPLAY_OFF", KEY_DISPLAY_OFF},
-  {"KEY_WWAN", KEY_WWAN},
+  {"KEY_VOLUMEDOWN", KEY_VOLUMEDOWN},
+  {"KEY_VOLUMEUP", KEY_VOLUMEUP},
+  {"KEY_W", KEY_W},
+  {"KEY_WAKEUP", KEY_WAKEUP},
   {"KEY_WIMAX", KEY_WIMAX},
-  {"KEY_RFKILL", KEY_RFKILL},
-  {"KEY_MICMUTE", KEY_MICMUTE},
+  {"KEY_WLAN", KEY_WLAN},
+  {"KEY_WWAN", KEY_WWAN},
+  {"KEY_WWW", KEY_WWW},
+  {"KEY_X", KEY_X},
+  {"KEY_XFER", KEY_XFER},
+  {"KEY_Y", KEY_Y},
+  {"KEY_YEN", KEY_YEN},
+  {"KEY_Z", KEY_Z},
+  {"KEY_ZENKAKUHANKAKU", KEY_ZENKAKUHANKAKU},
 };
 
-// cec_codes mapped from string to cec_user_control_codes enum in libcec/cectypes.h
-std::map<std::string, CEC::cec_user_control_code> cec_code_map
+
+// cec_codes mapped from string to cec_user_control_codes enum in
+// libcec/cectypes.h, sorted by name
+constexpr CECCodeName cec_code_names[]
 {
-  {"CEC_USER_CONTROL_CODE_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT},
-  {"CEC_USER_CONTROL_CODE_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UP},
+  {"CEC_USER_CONTROL_CODE_ANGLE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ANGLE},
+  {"CEC_USER_CONTROL_CODE_AN_CHANNELS_LIST", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_AN_CHANNELS_LIST},
+  {"CEC_USER_CONTROL_CODE_AN_RETURN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_AN_RETURN},
+  {"CEC_USER_CONTROL_CODE_BACKWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_BACKWARD},
+  {"CEC_USER_CONTROL_CODE_CHANNEL_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CHANNEL_DOWN},
+  {"CEC_USER_CONTROL_CODE_CHANNEL_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CHANNEL_UP},
+  {"CEC_USER_CONTROL_CODE_CLEAR", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CLEAR},
+  {"CEC_USER_CONTROL_CODE_CONTENTS_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CONTENTS_MENU},
+  {"CEC_USER_CONTROL_CODE_DATA", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DATA},
+  {"CEC_USER_CONTROL_CODE_DISPLAY_INFORMATION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DISPLAY_INFORMATION},
+  {"CEC_USER_CONTROL_CODE_DOT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DOT},
   {"CEC_USER_CONTROL_CODE_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DOWN},
+  {"CEC_USER_CONTROL_CODE_DVD_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DVD_MENU},
+  {"CEC_USER_CONTROL_CODE_EJECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_EJECT},
+  {"CEC_USER_CONTROL_CODE_ELECTRONIC_PROGRAM_GUIDE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ELECTRONIC_PROGRAM_GUIDE},
+  {"CEC_USER_CONTROL_CODE_ENTER", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ENTER},
+  {"CEC_USER_CONTROL_CODE_EXIT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_EXIT},
+  {"CEC_USER_CONTROL_CODE_F1_BLUE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F1_BLUE},
+  {"CEC_USER_CONTROL_CODE_F2_RED", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F2_RED},
+  {"CEC_USER_CONTROL_CODE_F3_GREEN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F3_GREEN},
+  {"CEC_USER_CONTROL_CODE_F4_YELLOW", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F4_YELLOW},
+  {"CEC_USER_CONTROL_CODE_F5", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F5},
+  {"CEC_USER_CONTROL_CODE_FAST_FORWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FAST_FORWARD},
+  {"CEC_USER_CONTROL_CODE_FAVORITE_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FAVORITE_MENU},
+  {"CEC_USER_CONTROL_CODE_FORWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FORWARD},
+  {"CEC_USER_CONTROL_CODE_HELP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_HELP},
+  {"CEC_USER_CONTROL_CODE_INITIAL_CONFIGURATION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_INITIAL_CONFIGURATION},
+  {"CEC_USER_CONTROL_CODE_INPUT_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_INPUT_SELECT},
   {"CEC_USER_CONTROL_CODE_LEFT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_LEFT},
-  {"CEC_USER_CONTROL_CODE_RIGHT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT},
-  {"CEC_USER_CONTROL_CODE_RIGHT_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT_UP},
-  {"CEC_USER_CONTROL_CODE_RIGHT_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT_DOWN},
-  {"CEC_USER_CONTROL_CODE_LEFT_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_LEFT_UP},
   {"CEC_USER_CONTROL_CODE_LEFT_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_LEFT_DOWN},
-  {"CEC_USER_CONTROL_CODE_ROOT_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ROOT_MENU},
-  {"CEC_USER_CONTROL_CODE_SETUP_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SETUP_MENU},
-  {"CEC_USER_CONTROL_CODE_CONTENTS_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CONTENTS_MENU},
-  {"CEC_USER_CONTROL_CODE_FAVORITE_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FAVORITE_MENU},
-  {"CEC_USER_CONTROL_CODE_EXIT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_EXIT},
-  {"CEC_USER_CONTROL_CODE_TOP_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_TOP_MENU},
-  {"CEC_USER_CONTROL_CODE_DVD_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DVD_MENU},
-  {"CEC_USER_CONTROL_CODE_NUMBER_ENTRY_MODE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER_ENTRY_MODE},
-  {"CEC_USER_CONTROL_CODE_NUMBER11", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER11},
-  {"CEC_USER_CONTROL_CODE_NUMBER12", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER12},
+  {"CEC_USER_CONTROL_CODE_LEFT_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_LEFT_UP},
+  {"CEC_USER_CONTROL_CODE_MAX", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MAX},
+  {"CEC_USER_CONTROL_CODE_MUTE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MUTE},
+  {"CEC_USER_CONTROL_CODE_MUTE_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MUTE_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_NEXT_FAVORITE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NEXT_FAVORITE},
   {"CEC_USER_CONTROL_CODE_NUMBER0", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER0},
   {"CEC_USER_CONTROL_CODE_NUMBER1", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER1},
+  {"CEC_USER_CONTROL_CODE_NUMBER11", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER11},
+  {"CEC_USER_CONTROL_CODE_NUMBER12", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER12},
   {"CEC_USER_CONTROL_CODE_NUMBER2", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER2},
   {"CEC_USER_CONTROL_CODE_NUMBER3", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER3},
   {"CEC_USER_CONTROL_CODE_NUMBER4", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER4},
@@ -328,66 +373,249 @@ std::map<std::string, CEC::cec_user_control_code> cec_code_map
   {"CEC_USER_CONTROL_CODE_NUMBER7", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER7},
   {"CEC_USER_CONTROL_CODE_NUMBER8", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER8},
   {"CEC_USER_CONTROL_CODE_NUMBER9", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER9},
-  {"CEC_USER_CONTROL_CODE_DOT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DOT},
-  {"CEC_USER_CONTROL_CODE_ENTER", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ENTER},
-  {"CEC_USER_CONTROL_CODE_CLEAR", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CLEAR},
-  {"CEC_USER_CONTROL_CODE_NEXT_FAVORITE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NEXT_FAVORITE},
-  {"CEC_USER_CONTROL_CODE_CHANNEL_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CHANNEL_UP},
-  {"CEC_USER_CONTROL_CODE_CHANNEL_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_CHANNEL_DOWN},
-  {"CEC_USER_CONTROL_CODE_PREVIOUS_CHANNEL", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PREVIOUS_CHANNEL},
-  {"CEC_USER_CONTROL_CODE_SOUND_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SOUND_SELECT},
-  {"CEC_USER_CONTROL_CODE_INPUT_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_INPUT_SELECT},
-  {"CEC_USER_CONTROL_CODE_DISPLAY_INFORMATION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DISPLAY_INFORMATION},
-  {"CEC_USER_CONTROL_CODE_HELP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_HELP},
-  {"CEC_USER_CONTROL_CODE_PAGE_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAGE_UP},
+  {"CEC_USER_CONTROL_CODE_NUMBER_ENTRY_MODE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_NUMBER_ENTRY_MODE},
   {"CEC_USER_CONTROL_CODE_PAGE_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAGE_DOWN},
-  {"CEC_USER_CONTROL_CODE_POWER", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER},
-  {"CEC_USER_CONTROL_CODE_VOLUME_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VOLUME_UP},
-  {"CEC_USER_CONTROL_CODE_VOLUME_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VOLUME_DOWN},
-  {"CEC_USER_CONTROL_CODE_MUTE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MUTE},
-  {"CEC_USER_CONTROL_CODE_PLAY", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PLAY},
-  {"CEC_USER_CONTROL_CODE_STOP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_STOP},
+  {"CEC_USER_CONTROL_CODE_PAGE_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAGE_UP},
   {"CEC_USER_CONTROL_CODE_PAUSE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE},
+  {"CEC_USER_CONTROL_CODE_PAUSE_PLAY_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_PLAY_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_PAUSE_RECORD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_RECORD},
+  {"CEC_USER_CONTROL_CODE_PAUSE_RECORD_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_RECORD_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_PLAY", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PLAY},
+  {"CEC_USER_CONTROL_CODE_PLAY_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PLAY_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_POWER", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER},
+  {"CEC_USER_CONTROL_CODE_POWER_OFF_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_OFF_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_POWER_ON_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_ON_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_POWER_TOGGLE_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_TOGGLE_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_PREVIOUS_CHANNEL", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PREVIOUS_CHANNEL},
   {"CEC_USER_CONTROL_CODE_RECORD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RECORD},
+  {"CEC_USER_CONTROL_CODE_RECORD_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RECORD_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_RESTORE_VOLUME_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RESTORE_VOLUME_FUNCTION},
   {"CEC_USER_CONTROL_CODE_REWIND", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_REWIND},
-  {"CEC_USER_CONTROL_CODE_FAST_FORWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FAST_FORWARD},
-  {"CEC_USER_CONTROL_CODE_EJECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_EJECT},
-  {"CEC_USER_CONTROL_CODE_FORWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_FORWARD},
-  {"CEC_USER_CONTROL_CODE_BACKWARD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_BACKWARD},
-  {"CEC_USER_CONTROL_CODE_STOP_RECORD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_STOP_RECORD},
-  {"CEC_USER_CONTROL_CODE_PAUSE_RECORD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_RECORD},
-  {"CEC_USER_CONTROL_CODE_ANGLE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ANGLE},
-  {"CEC_USER_CONTROL_CODE_SUB_PICTURE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SUB_PICTURE},
-  {"CEC_USER_CONTROL_CODE_VIDEO_ON_DEMAND", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VIDEO_ON_DEMAND},
-  {"CEC_USER_CONTROL_CODE_ELECTRONIC_PROGRAM_GUIDE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ELECTRONIC_PROGRAM_GUIDE},
-  {"CEC_USER_CONTROL_CODE_TIMER_PROGRAMMING", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_TIMER_PROGRAMMING},
-  {"CEC_USER_CONTROL_CODE_INITIAL_CONFIGURATION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_INITIAL_CONFIGURATION},
+  {"CEC_USER_CONTROL_CODE_RIGHT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT},
+  {"CEC_USER_CONTROL_CODE_RIGHT_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT_DOWN},
+  {"CEC_USER_CONTROL_CODE_RIGHT_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RIGHT_UP},
+  {"CEC_USER_CONTROL_CODE_ROOT_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_ROOT_MENU},
+  {"CEC_USER_CONTROL_CODE_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT},
+  {"CEC_USER_CONTROL_CODE_SELECT_AUDIO_INPUT_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_AUDIO_INPUT_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_SELECT_AV_INPUT_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_AV_INPUT_FUNCTION},
   {"CEC_USER_CONTROL_CODE_SELECT_BROADCAST_TYPE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_BROADCAST_TYPE},
+  {"CEC_USER_CONTROL_CODE_SELECT_MEDIA_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_MEDIA_FUNCTION},
   {"CEC_USER_CONTROL_CODE_SELECT_SOUND_PRESENTATION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_SOUND_PRESENTATION},
-  {"CEC_USER_CONTROL_CODE_PLAY_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PLAY_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_PAUSE_PLAY_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_PLAY_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_RECORD_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RECORD_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_PAUSE_RECORD_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_PAUSE_RECORD_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_SETUP_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SETUP_MENU},
+  {"CEC_USER_CONTROL_CODE_SOUND_SELECT", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SOUND_SELECT},
+  {"CEC_USER_CONTROL_CODE_STOP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_STOP},
   {"CEC_USER_CONTROL_CODE_STOP_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_STOP_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_MUTE_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MUTE_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_RESTORE_VOLUME_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_RESTORE_VOLUME_FUNCTION},
+  {"CEC_USER_CONTROL_CODE_STOP_RECORD", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_STOP_RECORD},
+  {"CEC_USER_CONTROL_CODE_SUB_PICTURE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SUB_PICTURE},
+  {"CEC_USER_CONTROL_CODE_TIMER_PROGRAMMING", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_TIMER_PROGRAMMING},
+  {"CEC_USER_CONTROL_CODE_TOP_MENU", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_TOP_MENU},
   {"CEC_USER_CONTROL_CODE_TUNE_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_TUNE_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_SELECT_MEDIA_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_MEDIA_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_SELECT_AV_INPUT_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_AV_INPUT_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_SELECT_AUDIO_INPUT_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_SELECT_AUDIO_INPUT_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_POWER_TOGGLE_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_TOGGLE_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_POWER_OFF_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_OFF_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_POWER_ON_FUNCTION", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_POWER_ON_FUNCTION},
-  {"CEC_USER_CONTROL_CODE_F1_BLUE", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F1_BLUE},
-  {"CEC_USER_CONTROL_CODE_F2_RED", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F2_RED},
-  {"CEC_USER_CONTROL_CODE_F3_GREEN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F3_GREEN},
-  {"CEC_USER_CONTROL_CODE_F4_YELLOW", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F4_YELLOW},
-  {"CEC_USER_CONTROL_CODE_F5", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_F5},
-  {"CEC_USER_CONTROL_CODE_DATA", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_DATA},
-  {"CEC_USER_CONTROL_CODE_AN_RETURN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_AN_RETURN},
-  {"CEC_USER_CONTROL_CODE_AN_CHANNELS_LIST", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_AN_CHANNELS_LIST},
-  {"CEC_USER_CONTROL_CODE_MAX", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_MAX},
   {"CEC_USER_CONTROL_CODE_UNKNOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UNKNOWN},
+  {"CEC_USER_CONTROL_CODE_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UP},
+  {"CEC_USER_CONTROL_CODE_VIDEO_ON_DEMAND", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VIDEO_ON_DEMAND},
+  {"CEC_USER_CONTROL_CODE_VOLUME_DOWN", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VOLUME_DOWN},
+  {"CEC_USER_CONTROL_CODE_VOLUME_UP", CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_VOLUME_UP},
 };
 
+
+constexpr int compareNames(const char* a, const char* b)
+{
+  while (*a && (*a == *b))
+  {
+    a++;
+    b++;
+  }
+
+  return (unsigned char) *a - (unsigned char) *b;
+}
+
+
+template <typename T, size_t N>
+constexpr bool namesSorted(const T (&table)[N])
+{
+  for (size_t i = 1; i < N; i++)
+  {
+    if (compareNames(table[i - 1].name, table[i].name) >= 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static_assert(namesSorted(input_key_names),
+              "input_key_names must be sorted by name");
+static_assert(namesSorted(cec_code_names),
+              "cec_code_names must be sorted by name");
+
+
+template <typename T, size_t N>
+const T* findName(const T (&table)[N], const char* name)
+{
+  size_t low = 0;
+  size_t high = N;
+
+  while (low < high)
+  {
+    size_t mid = (low + high) / 2;
+    int cmp = compareNames(table[mid].name, name);
+
+    if (cmp == 0)
+    {
+      return &table[mid];
+    }
+
+    if (cmp < 0)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return NULL;
+}
+
+
+// Code to name index built at compile time. Where several names share a
+// code the first one in name order is kept.
+struct CodeNameIndex
+{
+  static const int SIZE = 256;
+  const char* names[SIZE];
+
+  template <size_t N>
+  constexpr CodeNameIndex(const InputKeyName (&table)[N]) : names()
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (!names[table[i].input_key])
+      {
+        names[table[i].input_key] = table[i].name;
+      }
+    }
+  }
+
+  template <size_t N>
+  constexpr CodeNameIndex(const CECCodeName (&table)[N]) : names()
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (!names[table[i].cec_control_code])
+      {
+        names[table[i].cec_control_code] = table[i].name;
+      }
+    }
+  }
+
+  const char* operator[](int code) const
+  {
+    if ((code < 0) || (code >= SIZE) || !names[code])
+    {
+      return "";
+    }
+
+    return names[code];
+  }
+};
+
+constexpr CodeNameIndex input_key_index(input_key_names);
+constexpr CodeNameIndex cec_code_index(cec_code_names);
+
+
+inline bool getCECControlCode(const std::string& control_code_str,
+                              CEC::cec_user_control_code* cec_control_code)
+{
+  const CECCodeName* entry = findName(cec_code_names,
+                                      control_code_str.c_str());
+
+  if (!entry)
+  {
+    *cec_control_code = CEC::cec_user_control_code::CEC_USER_CONTROL_CODE_UNKNOWN;
+    return false;
+  }
+
+  *cec_control_code = entry->cec_control_code;
+  return true;
+}
+
+
+inline bool getInputKeyCode(const std::string& input_key_str, int* input_key)
+{
+  const InputKeyName* entry = findName(input_key_names,
+                                       input_key_str.c_str());
+
+  if (!entry)
+  {
+    *input_key = -1;
+    return false;
+  }
+
+  *input_key = entry->input_key;
+  return true;
+}
+
+
+// parse one key name, or up to MAX_CHORD_KEYS names joined with '+'
+inline bool getInputChord(const std::string& chord_str,
+                          UserInputDevice::Chord* chord)
+{
+  chord->count = 0;
+  size_t start = 0;
+
+  for (;;)
+  {
+    size_t end = chord_str.find('+', start);
+    int input_key;
+
+    if ((chord->count == UserInputDevice::MAX_CHORD_KEYS) ||
+        !getInputKeyCode(chord_str.substr(start, end - start), &input_key))
+    {
+      chord->count = 0;
+      return false;
+    }
+
+    chord->keys[chord->count++] = input_key;
+
+    if (end == std::string::npos)
+    {
+      return true;
+    }
+
+    start = end + 1;
+  }
+}
+
+
+inline const char* getCECControlStr(CEC::cec_user_control_code cec_control_code)
+{
+  return cec_code_index[cec_control_code];
+}
+
+
+inline const char* getKeyStr(int input_key)
+{
+  return input_key_index[input_key];
+}
+
+
+inline std::string getChordStr(const UserInputDevice::Chord& chord)
+{
+  std::string chord_str;
+
+  for (size_t i = 0; i < chord.count; i++)
+  {
+    if (i > 0)
+    {
+      chord_str += "+";
+    }
+    chord_str += getKeyStr(chord.keys[i]);
+  }
+
+  return chord_str;
+}
+
 #endif
@@ -0,0 +1,606 @@
+#include "cecsimulator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+namespace CECSimulator
+{
+  // the address and physical address libcec would give a recording device
+  // plugged into the TV's first input
+  static const CEC::cec_logical_address OWN_ADDRESS =
+    CEC::CECDEVICE_RECORDINGDEVICE1;
+
+  static const CEC::cec_user_control_code KEYS[] =
+  {
+    CEC::CEC_USER_CONTROL_CODE_UP,
+    CEC::CEC_USER_CONTROL_CODE_DOWN,
+    CEC::CEC_USER_CONTROL_CODE_LEFT,
+    CEC::CEC_USER_CONTROL_CODE_RIGHT,
+    CEC::CEC_USER_CONTROL_CODE_SELECT,
+    CEC::CEC_USER_CONTROL_CODE_EXIT
+  };
+
+  static const char* ADDRESS_NAMES[] =
+  {
+    "TV", "Recorder 1", "Recorder 2", "Tuner 1", "Playback 1", "Audio",
+    "Tuner 2", "Tuner 3", "Playback 2", "Recorder 3", "Tuner 4",
+    "Playback 3", "Reserved 1", "Reserved 2", "Free use", "Broadcast"
+  };
+
+  static const struct
+  {
+    uint32_t id;
+    const char* name;
+  } VENDORS[] =
+  {
+    {0x000039, "Toshiba"},
+    {0x0000F0, "Samsung"},
+    {0x0005CD, "Denon"},
+    {0x0009B0, "Onkyo"},
+    {0x001582, "Pulse Eight"},
+    {0x008045, "Panasonic"},
+    {0x00903E, "Philips"},
+    {0x00E091, "LG"},
+    {0x080046, "Sony"}
+  };
+
+
+  static CEC::cec_command emptyCommand(CEC::cec_logical_address initiator,
+                                       CEC::cec_logical_address destination)
+  {
+    CEC::cec_command command;
+    memset(&command, 0, sizeof(command));
+    command.initiator = initiator;
+    command.destination = destination;
+    command.eom = 1;
+    command.transmit_timeout = 1000;
+    return command;
+  }
+
+
+  CECSimulator::CECSimulator(const CEC::libcec_configuration& config,
+                             const Settings& settings) :
+    callbacks_(config.callbacks), callback_param_(config.callbackParam),
+    settings_(settings), random_(1), key_random_(1),
+    active_source_(CEC::CECDEVICE_UNKNOWN), volume_(20), muted_(false),
+    stopped_(false)
+  {
+    for (int i = 0; i < DEVICES; i++)
+    {
+      devices_[i] = {false, CEC_INVALID_PHYSICAL_ADDRESS,
+                     CEC::CEC_POWER_STATUS_UNKNOWN, 0, ""};
+    }
+
+    devices_[CEC::CECDEVICE_TV] =
+      {true, 0x0000, CEC::CEC_POWER_STATUS_ON, 0x0000F0, "TV"};
+    devices_[OWN_ADDRESS] =
+      {true, 0x1000, CEC::CEC_POWER_STATUS_ON, 0x001582,
+       config.strDeviceName};
+    devices_[CEC::CECDEVICE_PLAYBACKDEVICE1] =
+      {true, 0x2000, CEC::CEC_POWER_STATUS_STANDBY, 0x080046, "Media Player"};
+    devices_[CEC::CECDEVICE_AUDIOSYSTEM] =
+      {true, 0x3000, CEC::CEC_POWER_STATUS_ON, 0x0009B0, "AV Receiver"};
+
+    if (settings_.key_rate > 0)
+    {
+      key_thread_ = std::thread(&CECSimulator::sendKeys, this);
+    }
+  }
+
+
+  CECSimulator::~CECSimulator(void)
+  {
+    Close();
+  }
+
+
+  void CECSimulator::Close(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+
+    stop_requested_.notify_all();
+
+    if (key_thread_.joinable())
+    {
+      key_thread_.join();
+    }
+  }
+
+
+  // waits as long as a command takes on the bus, returns false if it wasn't
+  // acknowledged
+  bool CECSimulator::busOperation(void)
+  {
+    if (settings_.latency_ms > 0)
+    {
+      std::this_thread::sleep_for(
+        std::chrono::milliseconds(settings_.latency_ms));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::uniform_real_distribution<double>(0, 1)(random_) >=
+           settings_.failure_rate;
+  }
+
+
+  // broadcast changes every other device
+  bool CECSimulator::setPower(CEC::cec_logical_address address,
+                              CEC::cec_power_status power_status)
+  {
+    std::vector<CEC::cec_logical_address> changed;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for (int i = 0; i < DEVICES; i++)
+      {
+        bool addressed = (address == CEC::CECDEVICE_BROADCAST)
+                         ? (i != OWN_ADDRESS) : (i == address);
+
+        if (addressed && devices_[i].present &&
+            (devices_[i].power_status != power_status))
+        {
+          devices_[i].power_status = power_status;
+          changed.push_back((CEC::cec_logical_address) i);
+        }
+      }
+
+      if ((address != CEC::CECDEVICE_BROADCAST) &&
+          ((address < 0) || (address >= DEVICES) ||
+           !devices_[address].present))
+      {
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < changed.size(); i++)
+    {
+      reportPowerStatus(changed[i]);
+    }
+
+    return true;
+  }
+
+
+  // makes the device at physical_address the active source, switching it
+  // and the TV on
+  bool CECSimulator::activate(uint16_t physical_address)
+  {
+    CEC::cec_logical_address address = CEC::CECDEVICE_UNKNOWN;
+    CEC::cec_logical_address previous;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for (int i = 0; i < DEVICES; i++)
+      {
+        if (devices_[i].present &&
+            (devices_[i].physical_address == physical_address))
+        {
+          address = (CEC::cec_logical_address) i;
+        }
+      }
+
+      if (address == CEC::CECDEVICE_UNKNOWN)
+      {
+        return false;
+      }
+
+      previous = active_source_;
+      active_source_ = address;
+    }
+
+    setPower(CEC::CECDEVICE_TV, CEC::CEC_POWER_STATUS_ON);
+    setPower(address, CEC::CEC_POWER_STATUS_ON);
+
+    if ((previous == OWN_ADDRESS) && (address != OWN_ADDRESS) &&
+        callbacks_ && callbacks_->sourceActivated)
+    {
+      callbacks_->sourceActivated(callback_param_, OWN_ADDRESS, 0);
+    }
+
+    if (address == OWN_ADDRESS)
+    {
+      if (callbacks_ && callbacks_->sourceActivated)
+      {
+        callbacks_->sourceActivated(callback_param_, OWN_ADDRESS, 1);
+      }
+    }
+    else
+    {
+      reportActiveSource(address);
+    }
+
+    return true;
+  }
+
+
+  // a step of 0 toggles mute, returns the audio status the receiver reports
+  uint8_t CECSimulator::changeVolume(int step)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (devices_[CEC::CECDEVICE_AUDIOSYSTEM].power_status !=
+        CEC::CEC_POWER_STATUS_ON)
+    {
+      return 0;
+    }
+
+    if (step == 0)
+    {
+      muted_ = !muted_;
+    }
+    else
+    {
+      // libcec reports 0 when the receiver doesn't answer, so a working
+      // receiver is never turned down that far
+      int volume = volume_ + step;
+      volume_ = (volume < 1) ? 1 : ((volume > 100) ? 100 : volume);
+      muted_ = false;
+    }
+
+    return volume_ | (muted_ ? 0x80 : 0);
+  }
+
+
+  void CECSimulator::reportPowerStatus(CEC::cec_logical_address address)
+  {
+    CEC::cec_command command = emptyCommand(address, OWN_ADDRESS);
+    command.opcode = CEC::CEC_OPCODE_REPORT_POWER_STATUS;
+    command.opcode_set = 1;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      command.parameters.data[0] = devices_[address].power_status;
+      command.parameters.size = 1;
+    }
+
+    if (callbacks_ && callbacks_->commandReceived)
+    {
+      callbacks_->commandReceived(callback_param_, &command);
+    }
+  }
+
+
+  void CECSimulator::reportActiveSource(CEC::cec_logical_address address)
+  {
+    CEC::cec_command command = emptyCommand(address,
+                                            CEC::CECDEVICE_BROADCAST);
+    command.opcode = CEC::CEC_OPCODE_ACTIVE_SOURCE;
+    command.opcode_set = 1;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      command.parameters.data[0] = devices_[address].physical_address >> 8;
+      command.parameters.data[1] = devices_[address].physical_address & 0xFF;
+      command.parameters.size = 2;
+    }
+
+    if (callbacks_ && callbacks_->commandReceived)
+    {
+      callbacks_->commandReceived(callback_param_, &command);
+    }
+  }
+
+
+  bool CECSimulator::Transmit(const CEC::cec_command& data)
+  {
+    if ((data.destination < 0) || (data.destination >= DEVICES) ||
+        !busOperation())
+    {
+      return false;
+    }
+
+    if (data.destination != CEC::CECDEVICE_BROADCAST)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!devices_[data.destination].present)
+      {
+        return false;
+      }
+    }
+
+    if (!data.opcode_set)
+    {
+      // a poll, which only needs acknowledging
+      return true;
+    }
+
+    switch (data.opcode)
+    {
+      case CEC::CEC_OPCODE_STANDBY:
+        setPower(data.destination, CEC::CEC_POWER_STATUS_STANDBY);
+        break;
+      case CEC::CEC_OPCODE_IMAGE_VIEW_ON:
+      case CEC::CEC_OPCODE_TEXT_VIEW_ON:
+        setPower(data.destination, CEC::CEC_POWER_STATUS_ON);
+        break;
+      case CEC::CEC_OPCODE_SET_STREAM_PATH:
+        if (data.parameters.size >= 2)
+        {
+          activate((data.parameters[0] << 8) | data.parameters[1]);
+        }
+        break;
+      default:
+        break;
+    }
+
+    return true;
+  }
+
+
+  bool CECSimulator::PowerOnDevices(CEC::cec_logical_address address)
+  {
+    return busOperation() && setPower(address, CEC::CEC_POWER_STATUS_ON);
+  }
+
+
+  bool CECSimulator::StandbyDevices(CEC::cec_logical_address address)
+  {
+    return busOperation() &&
+           setPower(address, CEC::CEC_POWER_STATUS_STANDBY);
+  }
+
+
+  bool CECSimulator::SetActiveSource(void)
+  {
+    return busOperation() && activate(devices_[OWN_ADDRESS].physical_address);
+  }
+
+
+  bool CECSimulator::SetInactiveView(void)
+  {
+    if (!busOperation())
+    {
+      return false;
+    }
+
+    bool was_active;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      was_active = (active_source_ == OWN_ADDRESS);
+      if (was_active)
+      {
+        active_source_ = CEC::CECDEVICE_UNKNOWN;
+      }
+    }
+
+    if (was_active && callbacks_ && callbacks_->sourceActivated)
+    {
+      callbacks_->sourceActivated(callback_param_, OWN_ADDRESS, 0);
+    }
+
+    return true;
+  }
+
+
+  bool CECSimulator::SetStreamPath(uint16_t physical_address)
+  {
+    return busOperation() && activate(physical_address);
+  }
+
+
+  uint8_t CECSimulator::VolumeUp(bool)
+  {
+    return busOperation() ? changeVolume(1) : 0;
+  }
+
+
+  uint8_t CECSimulator::VolumeDown(bool)
+  {
+    return busOperation() ? changeVolume(-1) : 0;
+  }
+
+
+  uint8_t CECSimulator::AudioToggleMute(void)
+  {
+    return busOperation() ? changeVolume(0) : 0;
+  }
+
+
+  CEC::cec_logical_addresses CECSimulator::GetActiveDevices(void)
+  {
+    CEC::cec_logical_addresses addresses;
+    addresses.primary = OWN_ADDRESS;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < DEVICES; i++)
+    {
+      addresses.addresses[i] = devices_[i].present ? 1 : 0;
+    }
+
+    return addresses;
+  }
+
+
+  CEC::cec_logical_address CECSimulator::GetActiveSource(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_source_;
+  }
+
+
+  uint16_t CECSimulator::GetDevicePhysicalAddress(
+    CEC::cec_logical_address address)
+  {
+    if ((address < 0) || (address >= DEVICES))
+    {
+      return CEC_INVALID_PHYSICAL_ADDRESS;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_[address].physical_address;
+  }
+
+
+  CEC::cec_power_status CECSimulator::GetDevicePowerStatus(
+    CEC::cec_logical_address address)
+  {
+    if ((address < 0) || (address >= DEVICES))
+    {
+      return CEC::CEC_POWER_STATUS_UNKNOWN;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_[address].power_status;
+  }
+
+
+  uint32_t CECSimulator::GetDeviceVendorId(CEC::cec_logical_address address)
+  {
+    if ((address < 0) || (address >= DEVICES))
+    {
+      return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_[address].vendor_id;
+  }
+
+
+  std::string CECSimulator::GetDeviceOSDName(
+    CEC::cec_logical_address address)
+  {
+    if ((address < 0) || (address >= DEVICES))
+    {
+      return "";
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_[address].osd_name;
+  }
+
+
+  // the same format as libcec, hex bytes separated by colons starting with
+  // the initiator and destination, e.g. "10:36"
+  CEC::cec_command CECSimulator::CommandFromString(const char* command)
+  {
+    CEC::cec_command parsed = emptyCommand(CEC::CECDEVICE_UNKNOWN,
+                                           CEC::CECDEVICE_UNKNOWN);
+    const char* next = command;
+    int index = 0;
+
+    while (*next != '\0')
+    {
+      char* remain;
+      long int byte = strtol(next, &remain, 16);
+
+      if ((remain == next) || (byte < 0) || (byte > 0xFF) ||
+          ((*remain != ':') && (*remain != '\0')))
+      {
+        return emptyCommand(CEC::CECDEVICE_UNKNOWN, CEC::CECDEVICE_UNKNOWN);
+      }
+
+      if (index == 0)
+      {
+        parsed.initiator = (CEC::cec_logical_address) (byte >> 4);
+        parsed.destination = (CEC::cec_logical_address) (byte & 0x0F);
+      }
+      else if (index == 1)
+      {
+        parsed.opcode = (CEC::cec_opcode) byte;
+        parsed.opcode_set = 1;
+      }
+      else if (parsed.parameters.size < sizeof(parsed.parameters.data))
+      {
+        parsed.parameters.data[parsed.parameters.size++] = byte;
+      }
+
+      index++;
+      next = (*remain == ':') ? remain + 1 : remain;
+    }
+
+    return parsed;
+  }
+
+
+  const char* CECSimulator::ToString(CEC::cec_logical_address address)
+  {
+    if ((address < 0) || (address >= DEVICES))
+    {
+      return "unknown";
+    }
+
+    return ADDRESS_NAMES[address];
+  }
+
+
+  const char* CECSimulator::ToString(CEC::cec_power_status status)
+  {
+    switch (status)
+    {
+      case CEC::CEC_POWER_STATUS_ON:
+        return "on";
+      case CEC::CEC_POWER_STATUS_STANDBY:
+        return "standby";
+      case CEC::CEC_POWER_STATUS_IN_TRANSITION_STANDBY_TO_ON:
+        return "in transition from standby to on";
+      case CEC::CEC_POWER_STATUS_IN_TRANSITION_ON_TO_STANDBY:
+        return "in transition from on to standby";
+      default:
+        return "unknown";
+    }
+  }
+
+
+  const char* CECSimulator::VendorIdToString(uint32_t vendor_id)
+  {
+    for (size_t i = 0; i < sizeof(VENDORS) / sizeof(VENDORS[0]); i++)
+    {
+      if (VENDORS[i].id == vendor_id)
+      {
+        return VENDORS[i].name;
+      }
+    }
+
+    return "Unknown";
+  }
+
+
+  void CECSimulator::sendKeys(void)
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1 / settings_.key_rate));
+    Clock::time_point next = Clock::now() + interval;
+    std::uniform_int_distribution<size_t> pick(
+      0, sizeof(KEYS) / sizeof(KEYS[0]) - 1);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_requested_.wait_until(lock, next, [this]()
+                                       {
+                                         return stopped_;
+                                       }))
+    {
+      // a press is reported as it starts and again when released, the way
+      // libcec reports a quick tap
+      CEC::cec_keypress key;
+      key.keycode = KEYS[pick(key_random_)];
+      key.duration = 0;
+
+      lock.unlock();
+      if (callbacks_ && callbacks_->keyPress)
+      {
+        callbacks_->keyPress(callback_param_, &key);
+        key.duration = 100;
+        callbacks_->keyPress(callback_param_, &key);
+      }
+      lock.lock();
+
+      // falling behind isn't made up in a burst
+      next += interval;
+      if (next < Clock::now())
+      {
+        next = Clock::now() + interval;
+      }
+    }
+  }
+};
@@ -0,0 +1,102 @@
+#ifndef CECSIMULATOR_H
+#define CECSIMULATOR_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <libcec/cec.h>
+
+#include "../cecadapter/cecadapter.h"
+
+namespace CECSimulator
+{
+  struct Settings
+  {
+    double key_rate;      // remote button presses per second, 0 for none
+    uint32_t latency_ms;  // time each command takes on the bus
+    double failure_rate;  // fraction of commands that go unacknowledged
+  };
+
+
+  // Stands in for a CEC adapter on a bus with a TV, a media player and an
+  // AV receiver, so the daemon can run without any hardware. Commands take
+  // latency_ms and fail at failure_rate, and those that are acknowledged
+  // change the simulated devices and are answered through the
+  // configuration's callbacks the way the devices would answer them.
+  // Button presses are made up on a background thread at key_rate, using
+  // the same random sequence every run.
+  class CECSimulator : public CECAdapter::CECAdapter
+  {
+    public:
+      CECSimulator(const CEC::libcec_configuration& config,
+                   const Settings& settings);
+      ~CECSimulator();
+
+      void Close(void);
+
+      bool Transmit(const CEC::cec_command& data);
+      bool PowerOnDevices(CEC::cec_logical_address address);
+      bool StandbyDevices(CEC::cec_logical_address address);
+      bool SetActiveSource(void);
+      bool SetInactiveView(void);
+      bool SetStreamPath(uint16_t physical_address);
+      uint8_t VolumeUp(bool send_release);
+      uint8_t VolumeDown(bool send_release);
+      uint8_t AudioToggleMute(void);
+
+      CEC::cec_logical_addresses GetActiveDevices(void);
+      CEC::cec_logical_address GetActiveSource(void);
+      uint16_t GetDevicePhysicalAddress(CEC::cec_logical_address address);
+      CEC::cec_power_status GetDevicePowerStatus(
+        CEC::cec_logical_address address);
+      uint32_t GetDeviceVendorId(CEC::cec_logical_address address);
+      std::string GetDeviceOSDName(CEC::cec_logical_address address);
+
+      CEC::cec_command CommandFromString(const char* command);
+      const char* ToString(CEC::cec_logical_address address);
+      const char* ToString(CEC::cec_power_status status);
+      const char* VendorIdToString(uint32_t vendor_id);
+
+    private:
+      static const int DEVICES = 16;
+
+      struct Device
+      {
+        bool present;
+        uint16_t physical_address;
+        CEC::cec_power_status power_status;
+        uint32_t vendor_id;
+        std::string osd_name;
+      };
+
+      CEC::ICECCallbacks* callbacks_;
+      void* callback_param_;
+      Settings settings_;
+
+      std::mutex mutex_;
+      std::condition_variable stop_requested_;
+      std::mt19937 random_;     // decides which commands fail
+      std::mt19937 key_random_; // only used by the key thread
+      Device devices_[DEVICES];
+      CEC::cec_logical_address active_source_;
+      uint8_t volume_;
+      bool muted_;
+      bool stopped_;
+      std::thread key_thread_;
+
+      bool busOperation(void);
+      bool setPower(CEC::cec_logical_address address,
+                    CEC::cec_power_status power_status);
+      bool activate(uint16_t physical_address);
+      uint8_t changeVolume(int step);
+      void reportPowerStatus(CEC::cec_logical_address address);
+      void reportActiveSource(CEC::cec_logical_address address);
+      void sendKeys(void);
+  };
+};
+#endif
@@ -0,0 +1,96 @@
+#include "configreloader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "../logger/logger.h"
+
+namespace ConfigReloader
+{
+  ConfigReloader::ConfigReloader(ReloadFunction reload) :
+    reload_(reload), stopped_(false)
+  {
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+
+    if (event_fd_ < 0)
+    {
+      throw ConfigReloaderException(strerror(errno));
+    }
+
+    thread_ = std::thread(&ConfigReloader::run, this);
+  }
+
+
+  ConfigReloader::~ConfigReloader(void)
+  {
+    stopped_ = true;
+    notify();
+    thread_.join();
+    close(event_fd_);
+  }
+
+
+  void ConfigReloader::notify(void)
+  {
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0)
+    {
+      return;
+    }
+  }
+
+
+  void ConfigReloader::request(Completion done)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      waiting_.push_back(done);
+    }
+
+    notify();
+  }
+
+
+  void ConfigReloader::run(void)
+  {
+    for (;;)
+    {
+      // the counter is reset by the read, so any number of requests made
+      // before this point are handled by the one reload below
+      uint64_t requests;
+      if (read(event_fd_, &requests, sizeof(requests)) < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+
+        Logger::log(Logger::LEVEL_ERROR, "Config reload wait failed: %s",
+                    strerror(errno));
+        return;
+      }
+
+      if (stopped_)
+      {
+        return;
+      }
+
+      std::vector<Completion> waiting;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        waiting.swap(waiting_);
+      }
+
+      std::string message;
+      bool success = reload_(&message);
+
+      Logger::log(success ? Logger::LEVEL_INFO : Logger::LEVEL_WARNING, "%s",
+                  message.c_str());
+
+      for (size_t i = 0; i < waiting.size(); i++)
+      {
+        waiting[i](success, message);
+      }
+    }
+  }
+};
@@ -0,0 +1,70 @@
+#ifndef CONFIGRELOADER_H
+#define CONFIGRELOADER_H
+
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ConfigReloader
+{
+  // parses and applies the configuration, setting message to say what
+  // happened
+  typedef std::function<bool(std::string* message)> ReloadFunction;
+
+  typedef std::function<void(bool success, const std::string& message)>
+    Completion;
+
+
+  // Runs config reloads on a thread of their own, so parsing the file never
+  // happens on a thread that is handling keys or websocket clients.
+  // Requests that arrive while a reload is waiting are served by it.
+  class ConfigReloader
+  {
+    public:
+      ConfigReloader(ReloadFunction reload);
+      ~ConfigReloader();
+
+      // async-signal-safe, for SIGHUP
+      void notify(void);
+
+      // done is called on the reloader thread once the reload has run
+      void request(Completion done);
+
+    private:
+      ReloadFunction reload_;
+      int event_fd_;
+      std::mutex mutex_;
+      std::vector<Completion> waiting_;
+      std::atomic<bool> stopped_;
+      std::thread thread_;
+
+      void run(void);
+  };
+
+
+  class ConfigReloaderException: public std::exception
+  {
+    private:
+      std::string message_;
+
+    public:
+      ConfigReloaderException(const std::string& message) : message_(message)
+      {
+      }
+
+      virtual const char* what() const throw()
+      {
+        return message_.c_str();
+      }
+  };
+};
+#endif
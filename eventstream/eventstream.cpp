@@ -0,0 +1,195 @@
+#include "eventstream.h"
+
+#include <sstream>
+
+namespace EventStream
+{
+  bool parseEventMask(const std::string& names, uint32_t* mask)
+  {
+    static const struct
+    {
+      const char* name;
+      EventType type;
+    } event_names[] = {
+      {"key",      EVENT_KEY},
+      {"unmapped", EVENT_UNMAPPED},
+      {"source",   EVENT_SOURCE},
+      {"power",    EVENT_POWER}
+    };
+
+    if (names.empty())
+    {
+      *mask = EVENT_ALL;
+      return true;
+    }
+
+    std::istringstream stream(names);
+    std::string name;
+    uint32_t parsed = 0;
+
+    while (std::getline(stream, name, ','))
+    {
+      bool found = false;
+      for (size_t i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++)
+      {
+        if (name.compare(event_names[i].name) == 0)
+        {
+          parsed |= event_names[i].type;
+          found = true;
+          break;
+        }
+      }
+
+      if (!found)
+      {
+        return false;
+      }
+    }
+
+    *mask = parsed;
+    return parsed != 0;
+  }
+
+
+  EventStream::EventStream(Server* server, size_t max_buffered_bytes) :
+    server_(server), max_buffered_bytes_(max_buffered_bytes),
+    strand_(server->get_io_service()), subscribed_mask_(0), dropped_(0)
+  {
+  }
+
+
+  bool EventStream::subscribe(websocketpp::connection_hdl hdl, uint32_t mask)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ClientState& client = clients_[hdl];
+    client.mask = mask;
+    client.dropped = 0;
+    updateMask();
+    return true;
+  }
+
+
+  bool EventStream::unsubscribe(websocketpp::connection_hdl hdl)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    bool found = clients_.erase(hdl) > 0;
+    updateMask();
+    return found;
+  }
+
+
+  bool EventStream::wants(EventType type) const
+  {
+    return (subscribed_mask_.load(std::memory_order_relaxed) & type) != 0;
+  }
+
+
+  void EventStream::publish(EventType type, const Json::Value& event)
+  {
+    if (!wants(type))
+    {
+      return;
+    }
+
+    // the strand keeps events in the order they were published when the
+    // io_service runs on several threads
+    strand_.post(std::bind(&EventStream::fanOut, this, type, event));
+  }
+
+
+  size_t EventStream::subscribers(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_.size();
+  }
+
+
+  uint64_t EventStream::dropped(void) const
+  {
+    return dropped_;
+  }
+
+
+  void EventStream::fanOut(EventType type, const Json::Value& event)
+  {
+    Json::FastWriter fastWriter;
+    const std::string payload = fastWriter.write(event);
+
+    // made from the first connection sent to, then sent as is to every
+    // other subscriber rather than copied into a new message for each
+    Server::message_ptr message;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Clients::iterator it = clients_.begin();
+    while (it != clients_.end())
+    {
+      ClientState& client = it->second;
+      if (!(client.mask & type))
+      {
+        it++;
+        continue;
+      }
+
+      Server::connection_ptr con;
+      try
+      {
+        con = server_->get_con_from_hdl(it->first);
+      }
+      catch (websocketpp::exception const &)
+      {
+        // the connection has gone, it can't be sent anything else
+        it = clients_.erase(it);
+        continue;
+      }
+
+      // events waiting behind a full send buffer are stale by the time they
+      // arrive, so they are dropped instead of queued
+      if (con->get_buffered_amount() > max_buffered_bytes_)
+      {
+        client.dropped++;
+        dropped_++;
+        it++;
+        continue;
+      }
+
+      if (client.dropped > 0)
+      {
+        Json::Value droppedJson;
+        droppedJson["event"] = "dropped";
+        droppedJson["count"] = (Json::UInt64) client.dropped;
+        con->send(fastWriter.write(droppedJson),
+                  websocketpp::frame::opcode::text);
+        client.dropped = 0;
+      }
+
+      if (!message)
+      {
+        message = con->get_message(websocketpp::frame::opcode::text,
+                                   payload.size());
+        message->set_payload(payload);
+      }
+
+      con->send(message);
+      it++;
+    }
+
+    updateMask();
+  }
+
+
+  // called with mutex_ held
+  void EventStream::updateMask(void)
+  {
+    uint32_t mask = 0;
+    for (Clients::const_iterator it = clients_.begin(); it != clients_.end();
+         it++)
+    {
+      mask |= it->second.mask;
+    }
+
+    subscribed_mask_ = mask;
+  }
+};
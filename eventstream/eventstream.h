@@ -0,0 +1,82 @@
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <json/json.h>
+
+namespace EventStream
+{
+  // Kinds of event a client can subscribe to, used as a bit mask
+  enum EventType
+  {
+    EVENT_KEY      = 0x01, // key press reported by libcec
+    EVENT_UNMAPPED = 0x02, // key press with no mapping in the keymap
+    EVENT_SOURCE   = 0x04, // active source changes
+    EVENT_POWER    = 0x08, // power state changes
+    EVENT_ALL      = 0x0F
+  };
+
+  // parse a comma separated list of event names, an empty list is every
+  // event
+  bool parseEventMask(const std::string& names, uint32_t* mask);
+
+
+  // Pushes bus events to subscribed websocket clients. Producers only pay
+  // for queueing the event on the io_service; it is serialized once, on the
+  // websocket threads, into one message that is sent to every subscriber.
+  // Clients that fall behind have events dropped rather than buffered, and
+  // are told how many they missed once they catch up.
+  class EventStream
+  {
+    public:
+      typedef websocketpp::server<websocketpp::config::asio> Server;
+
+      // server must already have been through init_asio()
+      EventStream(Server* server, size_t max_buffered_bytes);
+
+      bool subscribe(websocketpp::connection_hdl hdl, uint32_t mask);
+      bool unsubscribe(websocketpp::connection_hdl hdl);
+
+      // true if any client is subscribed to type, so producers can skip
+      // building events nobody will receive
+      bool wants(EventType type) const;
+
+      // safe to call from any thread
+      void publish(EventType type, const Json::Value& event);
+
+      size_t subscribers(void);
+      uint64_t dropped(void) const;
+
+    private:
+      struct ClientState
+      {
+        uint32_t mask;
+        uint64_t dropped; // events skipped since the last one delivered
+      };
+
+      typedef std::map<websocketpp::connection_hdl, ClientState,
+                       std::owner_less<websocketpp::connection_hdl> > Clients;
+
+      Server* server_;
+      size_t max_buffered_bytes_;
+      websocketpp::lib::asio::io_service::strand strand_;
+
+      std::mutex mutex_;
+      Clients clients_;
+      std::atomic<uint32_t> subscribed_mask_;
+      std::atomic<uint64_t> dropped_;
+
+      void fanOut(EventType type, const Json::Value& event);
+      void updateMask(void);
+  };
+};
+#endif
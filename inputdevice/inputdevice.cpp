@@ -2,7 +2,8 @@
 
 namespace UserInputDevice
 {
-  InputDevice::InputDevice(std::string uinput)
+  InputDevice::InputDevice(std::string uinput, bool autorepeat,
+                           const std::string& name)
   {
     struct input_id uid;
     memset(&uid, 0, sizeof(uid));
@@ -18,13 +19,18 @@ namespace UserInputDevice
     }
     ioctl(device_fd_, UI_SET_EVBIT, EV_KEY);
 
+    if (autorepeat)
+    {
+      ioctl(device_fd_, UI_SET_EVBIT, EV_REP);
+    }
+
     for (int i = 0; i < 256; i++)
     {
       ioctl(device_fd_, UI_SET_KEYBIT, i);
     }
 
     usetup.id = uid;
-    strcpy(usetup.name, "ui_device");
+    strncpy(usetup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
 
     ioctl(device_fd_, UI_DEV_SETUP, &usetup);
     ioctl(device_fd_, UI_DEV_CREATE);
@@ -40,7 +46,7 @@ namespace UserInputDevice
   }
 
 
-  void InputDevice::emit(int type, int code, int val)
+  void InputDevice::appendEvent(int type, int code, int val)
   {
     struct input_event ie;
     memset(&ie, 0, sizeof(ie));
@@ -48,18 +54,66 @@ namespace UserInputDevice
     ie.code = code;
     ie.value = val;
 
-    if (write(device_fd_, &ie, sizeof(ie)) < 0)
+    events_.push_back(ie);
+  }
+
+
+  void InputDevice::flushEvents(void)
+  {
+    if (events_.empty())
+    {
+      return;
+    }
+
+    size_t length = events_.size() * sizeof(struct input_event);
+    ssize_t written = write(device_fd_, events_.data(), length);
+    events_.clear();
+
+    if (written < 0)
     {
       throw InputDeviceException(strerror(errno));
     }
+
+    // the rest of the batch is lost, which can leave a key held down
+    if ((size_t) written != length)
+    {
+      throw InputDeviceException("short write to uinput device");
+    }
   }
 
 
   void InputDevice::sendKeyInput(int key)
   {
-    emit(EV_KEY, key, 1);
-    emit(EV_SYN, SYN_REPORT, 0);
-    emit(EV_KEY, key, 0);
-    emit(EV_SYN, SYN_REPORT, 0);
+    KeyEvent event = {singleKey(key), ACTION_TAP};
+    sendKeyEvents(&event, 1);
+  }
+
+
+  void InputDevice::sendKeyEvents(const KeyEvent* events, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      const Chord& chord = events[i].chord;
+
+      if (events[i].action != ACTION_RELEASE)
+      {
+        for (size_t j = 0; j < chord.count; j++)
+        {
+          appendEvent(EV_KEY, chord.keys[j], 1);
+        }
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+      }
+
+      if (events[i].action != ACTION_PRESS)
+      {
+        for (size_t j = chord.count; j > 0; j--)
+        {
+          appendEvent(EV_KEY, chord.keys[j - 1], 0);
+        }
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+      }
+    }
+
+    flushEvents();
   }
 };
@@ -5,28 +5,92 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <stdint.h>
 
 #include <iostream>
 #include <cstring>
 #include <string>
 #include <exception>
+#include <vector>
 
 #include <linux/uinput.h>
 
 namespace UserInputDevice
 {
+  enum KeyAction
+  {
+    ACTION_TAP,     // press immediately followed by release
+    ACTION_PRESS,   // key down, held until a matching ACTION_RELEASE
+    ACTION_RELEASE  // key up
+  };
+
+
+  static const size_t MAX_CHORD_KEYS = 4;
+
+  // Keys that go down and up together, such as KEY_LEFTCTRL+KEY_W. Keys are
+  // pressed in order and released in reverse order.
+  struct Chord
+  {
+    uint16_t keys[MAX_CHORD_KEYS];
+    uint8_t count;
+  };
+
+
+  inline Chord singleKey(int key)
+  {
+    Chord chord = {{(uint16_t) key}, 1};
+    return chord;
+  }
+
+
+  inline bool operator==(const Chord& a, const Chord& b)
+  {
+    if (a.count != b.count)
+    {
+      return false;
+    }
+
+    for (size_t i = 0; i < a.count; i++)
+    {
+      if (a.keys[i] != b.keys[i])
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  struct KeyEvent
+  {
+    Chord chord;
+    KeyAction action;
+  };
+
+
   class InputDevice
   {
     public:
-      InputDevice(std::string uinput);
+      // with autorepeat set, EV_REP is enabled and the kernel repeats keys
+      // that are held down with ACTION_PRESS. name is the name the device
+      // is listed under, truncated to fit uinput's limit.
+      InputDevice(std::string uinput, bool autorepeat = false,
+                  const std::string& name = "ui_device");
       ~InputDevice();
 
       void sendKeyInput(int key);
 
+      // emit every event in turn with a single write(). All the keys of a
+      // chord change state in one SYN_REPORT.
+      void sendKeyEvents(const KeyEvent* events, size_t count);
+
     private:
       int device_fd_;
+      std::vector<struct input_event> events_;
 
-      void emit(int type, int code, int val);
+      void appendEvent(int type, int code, int val);
+      void flushEvents(void);
   };
 
 
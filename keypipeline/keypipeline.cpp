@@ -0,0 +1,346 @@
+#include "keypipeline.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <thread>
+
+#include "../ceckeymap.h"
+#include "../logger/logger.h"
+
+namespace KeyPipeline
+{
+  // Keeps setKeyTable() from freeing a key table while it is in use
+  class KeyTableReader
+  {
+    public:
+      KeyTableReader(const std::atomic<const KeyTable::KeyTable*>& key_table,
+                     std::atomic<int>& readers) : readers_(readers)
+      {
+        // counted before the load, so a writer that swaps the pointer
+        // afterwards is guaranteed to see this reader
+        readers_++;
+        key_table_ = key_table.load();
+      }
+
+      ~KeyTableReader()
+      {
+        readers_--;
+      }
+
+      const KeyTable::KeyTable& operator*() const
+      {
+        return *key_table_;
+      }
+
+    private:
+      std::atomic<int>& readers_;
+      const KeyTable::KeyTable* key_table_;
+  };
+
+
+  KeyPipeline::KeyPipeline(UserInputDevice::InputDevice* device,
+                           size_t queue_size,
+                           KeyQueue::OverflowPolicy overflow,
+                           bool kernel_repeat) :
+    device_(device), queue_(queue_size, overflow),
+    key_table_(new KeyTable::KeyTable()), key_table_readers_(0),
+    kernel_repeat_(kernel_repeat), stopped_(false),
+    queued_keys_(queue_size), key_events_(queue_size)
+  {
+    held_chord_.count = 0;
+
+    for (int i = 0; i < 256; i++)
+    {
+      unmapped_logged_ns_[i] = 0;
+      unmapped_suppressed_[i] = 0;
+    }
+  }
+
+
+  KeyPipeline::~KeyPipeline(void)
+  {
+    delete key_table_.load();
+  }
+
+
+  void KeyPipeline::cecKeyPressCB(void* cbparam, const CEC::cec_keypress* msg)
+  {
+    uint64_t received_ns = Stats::monotonicNs();
+    static_cast<KeyPipeline*>(cbparam)->handleCECKeyPress(*msg, received_ns);
+  }
+
+
+  void KeyPipeline::setDevice(UserInputDevice::InputDevice* device)
+  {
+    device_ = device;
+  }
+
+
+  void KeyPipeline::setKeyTable(const KeyTable::KeyTable& key_table)
+  {
+    const KeyTable::KeyTable* next_table = new KeyTable::KeyTable(key_table);
+
+    std::lock_guard<std::mutex> lock(key_table_writer_mutex_);
+    const KeyTable::KeyTable* old_table = key_table_.exchange(next_table);
+
+    // a key press takes microseconds, so this is a short wait
+    while (key_table_readers_ > 0)
+    {
+      std::this_thread::yield();
+    }
+
+    delete old_table;
+  }
+
+
+  void KeyPipeline::setCECKeyObserver(CECKeyObserver observer)
+  {
+    cec_key_observer_ = observer;
+  }
+
+
+  void KeyPipeline::setCECMacroHandler(CECMacroHandler handler)
+  {
+    cec_macro_handler_ = handler;
+  }
+
+
+  bool KeyPipeline::translateCECToKeyCode(
+    CEC::cec_user_control_code cec_control_code, int* input_key) const
+  {
+    KeyTableReader key_table(key_table_, key_table_readers_);
+    *input_key = (*key_table).lookup(cec_control_code);
+    return *input_key >= 0;
+  }
+
+
+  void KeyPipeline::handleCECKeyPress(const CEC::cec_keypress& msg,
+                                      uint64_t received_ns)
+  {
+    KeyTableReader key_table(key_table_, key_table_readers_);
+    const KeyTable::Binding& binding = (*key_table).binding(msg.keycode);
+    const UserInputDevice::Chord& chord = binding.chord;
+
+    if (cec_key_observer_)
+    {
+      cec_key_observer_(msg, *key_table);
+    }
+
+    if (binding.macro >= 0)
+    {
+      // macros play once per press, repeats and releases are ignored
+      if ((msg.duration == 0) && cec_macro_handler_)
+      {
+        cec_macro_handler_((*key_table).macros()[binding.macro]);
+      }
+    }
+    else if (chord.count > 0)
+    {
+      if (!kernel_repeat_)
+      {
+        queueKey(chord, UserInputDevice::ACTION_TAP,
+                 KeyQueue::SOURCE_CEC, received_ns);
+      }
+      else if (msg.duration == 0)
+      {
+        // a press reported again while held is a repeat from the TV, which
+        // the kernel is already generating
+        if (held_chord_ == chord)
+        {
+          return;
+        }
+
+        if (held_chord_.count > 0)
+        {
+          queueKey(held_chord_, UserInputDevice::ACTION_RELEASE,
+                   KeyQueue::SOURCE_CEC, received_ns);
+        }
+
+        if (queueKey(chord, UserInputDevice::ACTION_PRESS,
+                     KeyQueue::SOURCE_CEC, received_ns))
+        {
+          held_chord_ = chord;
+        }
+      }
+      else if (held_chord_.count > 0)
+      {
+        if (queueKey(held_chord_, UserInputDevice::ACTION_RELEASE,
+                     KeyQueue::SOURCE_CEC, received_ns))
+        {
+          held_chord_.count = 0;
+        }
+      }
+    }
+    else if (msg.duration == 0)
+    {
+      stats_.unmapped_codes++;
+      stats_.unmapped_by_code[msg.keycode & 0xFF]++;
+
+      // a button held on a remote the keymap doesn't cover would
+      // otherwise log every repeat
+      int code = msg.keycode & 0xFF;
+      if ((unmapped_logged_ns_[code] != 0) &&
+          (received_ns - unmapped_logged_ns_[code] < 1000000000ULL))
+      {
+        unmapped_suppressed_[code]++;
+      }
+      else if (unmapped_suppressed_[code] > 0)
+      {
+        Logger::log(Logger::LEVEL_INFO,
+                    "Unmapped CEC code received: %s (%u more since last "
+                    "logged)", getCECControlStr(msg.keycode),
+                    unmapped_suppressed_[code]);
+        unmapped_logged_ns_[code] = received_ns;
+        unmapped_suppressed_[code] = 0;
+      }
+      else
+      {
+        Logger::log(Logger::LEVEL_INFO, "Unmapped CEC code received: %s",
+                    getCECControlStr(msg.keycode));
+        unmapped_logged_ns_[code] = received_ns;
+        unmapped_suppressed_[code] = 0;
+      }
+    }
+  }
+
+
+  bool KeyPipeline::queueKey(const UserInputDevice::Chord& chord,
+                             UserInputDevice::KeyAction action,
+                             KeyQueue::KeySource source, uint64_t received_ns)
+  {
+    KeyQueue::QueuedKey key;
+    key.event.chord = chord;
+    key.event.action = action;
+    key.source = source;
+    key.received_ns = received_ns;
+
+    return queue_.push(key);
+  }
+
+
+  bool KeyPipeline::queueKeys(const UserInputDevice::KeyEvent* events,
+                              size_t count, KeyQueue::KeySource source,
+                              uint64_t received_ns)
+  {
+    // small batches are staged on the stack so the common case doesn't
+    // allocate
+    KeyQueue::QueuedKey stack_keys[64];
+    std::vector<KeyQueue::QueuedKey> heap_keys;
+    KeyQueue::QueuedKey* keys = stack_keys;
+
+    if (count > sizeof(stack_keys) / sizeof(stack_keys[0]))
+    {
+      heap_keys.resize(count);
+      keys = heap_keys.data();
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      keys[i].event = events[i];
+      keys[i].source = source;
+      keys[i].received_ns = received_ns;
+    }
+
+    return queue_.pushBatch(keys, count);
+  }
+
+
+  void KeyPipeline::run(void)
+  {
+    while (!stopped_)
+    {
+      // blocks until a producer or stop() notifies the queue, so the
+      // process is idle while nothing is queued
+      if (!queue_.wait())
+      {
+        Logger::log(Logger::LEVEL_ERROR, "Key queue wait failed: %s",
+                    strerror(errno));
+        break;
+      }
+
+      stats_.wakeups++;
+
+      size_t drained = dispatchQueued();
+      if (drained > 0)
+      {
+        stats_.drained_per_wakeup.record(drained);
+      }
+    }
+  }
+
+
+  size_t KeyPipeline::dispatchQueued(void)
+  {
+    size_t count;
+    size_t drained = 0;
+
+    while ((count = queue_.popAll(queued_keys_.data(),
+                                  queued_keys_.size())) > 0)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        key_events_[i] = queued_keys_[i].event;
+      }
+
+      try
+      {
+        device_->sendKeyEvents(key_events_.data(), count);
+      }
+      catch (UserInputDevice::InputDeviceException& e)
+      {
+        // none of the batch is counted as sent, nor its latency recorded
+        stats_.write_errors++;
+        stats_.failed_keys += count;
+        drained += count;
+        Logger::log(Logger::LEVEL_ERROR,
+                    "Failed to write to user input device: %s", e.what());
+        continue;
+      }
+
+      uint64_t sent_ns = Stats::monotonicNs();
+
+      for (size_t i = 0; i < count; i++)
+      {
+        uint64_t latency_ns = sent_ns - queued_keys_[i].received_ns;
+
+        if (queued_keys_[i].source == KeyQueue::SOURCE_CEC)
+        {
+          stats_.cec_keys++;
+          stats_.cec_latency_ns.record(latency_ns);
+        }
+        else
+        {
+          stats_.ws_keys++;
+          stats_.ws_latency_ns.record(latency_ns);
+        }
+      }
+
+      drained += count;
+    }
+
+    return drained;
+  }
+
+
+  void KeyPipeline::stop(void)
+  {
+    // nothing drains the queue from here on, so producers blocked on it
+    // give up rather than holding up shutdown
+    stopped_ = true;
+    queue_.close();
+    queue_.notify();
+  }
+
+
+  const KeyQueue::KeyQueue& KeyPipeline::queue(void) const
+  {
+    return queue_;
+  }
+
+
+  const Stats::PipelineStats& KeyPipeline::stats(void) const
+  {
+    return stats_;
+  }
+};
@@ -0,0 +1,109 @@
+#ifndef KEYPIPELINE_H
+#define KEYPIPELINE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "libcec/cectypes.h"
+
+#include "../inputdevice/inputdevice.h"
+#include "../keyqueue/keyqueue.h"
+#include "../keytable/keytable.h"
+#include "../stats/stats.h"
+
+namespace KeyPipeline
+{
+  // told about every key press libcec reports, on the libcec callback
+  // thread, along with the key table it was looked up in
+  typedef std::function<void(const CEC::cec_keypress& msg,
+                             const KeyTable::KeyTable& key_table)>
+    CECKeyObserver;
+
+  // plays the macro a pressed CEC code is mapped to, on the libcec callback
+  // thread. The macro is only valid for the duration of the call.
+  typedef std::function<void(const KeyTable::Macro& macro)> CECMacroHandler;
+
+
+  // The path a key takes from the libcec callback or the websocket thread,
+  // through the key queue, to the uinput device. Producers may call into it
+  // from any thread; run() is the single consumer.
+  class KeyPipeline
+  {
+    public:
+      // device may be NULL if it is given later with setDevice(), keys
+      // can be queued before then
+      KeyPipeline(UserInputDevice::InputDevice* device, size_t queue_size,
+                  KeyQueue::OverflowPolicy overflow, bool kernel_repeat);
+      ~KeyPipeline();
+
+      // must be called before run()
+      void setDevice(UserInputDevice::InputDevice* device);
+
+      // libcec keyPress callback, cbparam must point to the KeyPipeline
+      static void cecKeyPressCB(void* cbparam, const CEC::cec_keypress* msg);
+
+      // safe to call at any time from any thread. The new table is
+      // swapped in atomically, and this waits until no key press is still
+      // using the old one before freeing it.
+      void setKeyTable(const KeyTable::KeyTable& key_table);
+
+      // must be set before libcec starts calling cecKeyPressCB
+      void setCECKeyObserver(CECKeyObserver observer);
+      void setCECMacroHandler(CECMacroHandler handler);
+
+      bool translateCECToKeyCode(CEC::cec_user_control_code cec_control_code,
+                                 int* input_key) const;
+
+      bool queueKey(const UserInputDevice::Chord& chord,
+                    UserInputDevice::KeyAction action,
+                    KeyQueue::KeySource source, uint64_t received_ns);
+
+      // queue every event or none of them, see KeyQueue::pushBatch
+      bool queueKeys(const UserInputDevice::KeyEvent* events, size_t count,
+                     KeyQueue::KeySource source, uint64_t received_ns);
+
+      // dispatch queued keys to the input device until stop() is called
+      void run(void);
+
+      // async-signal-safe
+      void stop(void);
+
+      const KeyQueue::KeyQueue& queue(void) const;
+      const Stats::PipelineStats& stats(void) const;
+
+    private:
+      UserInputDevice::InputDevice* device_;
+      KeyQueue::KeyQueue queue_;
+      // read without locking by the libcec callback thread; readers are
+      // counted so setKeyTable knows when the old table can be freed
+      std::atomic<const KeyTable::KeyTable*> key_table_;
+      mutable std::atomic<int> key_table_readers_;
+      std::mutex key_table_writer_mutex_;
+      CECKeyObserver cec_key_observer_;
+      CECMacroHandler cec_macro_handler_;
+      Stats::PipelineStats stats_;
+      bool kernel_repeat_;
+      std::atomic<bool> stopped_;
+
+      // keys currently held down in kernel repeat mode, only touched from
+      // the libcec callback thread
+      UserInputDevice::Chord held_chord_;
+
+      // an unmapped code is logged at most once a second, also only
+      // touched from the libcec callback thread
+      uint64_t unmapped_logged_ns_[256];
+      uint32_t unmapped_suppressed_[256];
+
+      std::vector<KeyQueue::QueuedKey> queued_keys_;
+      std::vector<UserInputDevice::KeyEvent> key_events_;
+
+      void handleCECKeyPress(const CEC::cec_keypress& msg,
+                             uint64_t received_ns);
+      size_t dispatchQueued(void);
+  };
+};
+#endif
@@ -0,0 +1,212 @@
+#include "keyqueue.h"
+
+#include <errno.h>
+#include <sched.h>
+
+namespace KeyQueue
+{
+  KeyQueue::KeyQueue(size_t capacity, OverflowPolicy policy) :
+    policy_(policy), tail_(0), head_(0), overflows_(0), closed_(false)
+  {
+    size_t rounded = 1;
+    while (rounded < capacity)
+    {
+      rounded <<= 1;
+    }
+
+    slots_.reset(new Slot[rounded]);
+    mask_ = rounded - 1;
+
+    for (size_t i = 0; i < rounded; i++)
+    {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+
+    if (event_fd_ < 0)
+    {
+      throw KeyQueueException(strerror(errno));
+    }
+  }
+
+
+  KeyQueue::~KeyQueue(void)
+  {
+    if (event_fd_ >= 0)
+    {
+      ::close(event_fd_);
+    }
+  }
+
+
+  bool KeyQueue::push(const QueuedKey& key)
+  {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Slot& slot = slots_[pos & mask_];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+        {
+          slot.key = key;
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          notify();
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        // the slot still holds a key from the previous lap, the queue is full
+        if ((policy_ == DROP_NEWEST) ||
+            closed_.load(std::memory_order_acquire))
+        {
+          overflows_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+
+        sched_yield();
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+
+  bool KeyQueue::pushBatch(const QueuedKey* keys, size_t count)
+  {
+    if (count == 0)
+    {
+      return true;
+    }
+
+    if (count > mask_ + 1)
+    {
+      overflows_.fetch_add(count, std::memory_order_relaxed);
+      return false;
+    }
+
+    size_t pos = tail_.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      // the consumer frees slots in order, so if the last slot of the range
+      // is free for this lap every earlier one is too
+      size_t last = pos + count - 1;
+      size_t seq = slots_[last & mask_].sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) last;
+
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + count,
+                                        std::memory_order_relaxed))
+        {
+          for (size_t i = 0; i < count; i++)
+          {
+            Slot& slot = slots_[(pos + i) & mask_];
+            slot.key = keys[i];
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+          }
+
+          notify();
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        if ((policy_ == DROP_NEWEST) ||
+            closed_.load(std::memory_order_acquire))
+        {
+          overflows_.fetch_add(count, std::memory_order_relaxed);
+          return false;
+        }
+
+        sched_yield();
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+
+  void KeyQueue::notify(void)
+  {
+    // async-signal-safe, so the signal handlers may use it to stop the
+    // consumer
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0)
+    {
+      return;
+    }
+  }
+
+
+  void KeyQueue::close(void)
+  {
+    closed_.store(true, std::memory_order_release);
+  }
+
+
+  size_t KeyQueue::size(void) const
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return (tail > head) ? tail - head : 0;
+  }
+
+
+  uint64_t KeyQueue::overflows(void) const
+  {
+    return overflows_.load(std::memory_order_relaxed);
+  }
+
+
+  bool KeyQueue::wait(void)
+  {
+    uint64_t pending;
+    if (read(event_fd_, &pending, sizeof(pending)) < 0)
+    {
+      return errno == EINTR;
+    }
+
+    return true;
+  }
+
+
+  size_t KeyQueue::popAll(QueuedKey* keys, size_t max_keys)
+  {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    size_t count = 0;
+
+    while (count < max_keys)
+    {
+      Slot& slot = slots_[pos & mask_];
+
+      if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+      {
+        // empty, or a producer has claimed the slot but not yet published
+        // it; its notify() will wake us again
+        break;
+      }
+
+      keys[count++] = slot.key;
+      slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+      pos++;
+    }
+
+    head_.store(pos, std::memory_order_relaxed);
+    return count;
+  }
+};
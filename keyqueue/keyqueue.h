@@ -0,0 +1,107 @@
+#ifndef KEYQUEUE_H
+#define KEYQUEUE_H
+
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <string>
+#include <exception>
+
+#include "../inputdevice/inputdevice.h"
+
+namespace KeyQueue
+{
+  // What push() does when the queue is full
+  enum OverflowPolicy
+  {
+    DROP_NEWEST, // reject the new event and count it as an overflow
+    BLOCK        // yield until the consumer has made room, or the queue
+                 // is closed, which drops the event like DROP_NEWEST
+  };
+
+
+  enum KeySource
+  {
+    SOURCE_CEC,
+    SOURCE_WEBSOCKET
+  };
+
+
+  struct QueuedKey
+  {
+    UserInputDevice::KeyEvent event;
+    KeySource source;
+    uint64_t received_ns; // monotonic time the key reached the daemon
+  };
+
+
+  // Bounded multi-producer single-consumer queue of key events. Producers
+  // never take a lock or allocate; the consumer sleeps on an eventfd until
+  // notify() is called.
+  class KeyQueue
+  {
+    public:
+      KeyQueue(size_t capacity, OverflowPolicy policy = DROP_NEWEST);
+      ~KeyQueue();
+
+      // safe to call from any thread
+      bool push(const QueuedKey& key);
+
+      // queue all keys in order with nothing from other producers between
+      // them, or none of them if there is not room for the whole batch
+      bool pushBatch(const QueuedKey* keys, size_t count);
+      void notify(void);
+
+      // releases producers blocked on a full queue, so they don't wait for
+      // a consumer that has stopped. Safe to call from a signal handler.
+      void close(void);
+      size_t size(void) const;
+      uint64_t overflows(void) const;
+
+      // consumer thread only
+      bool wait(void);
+      size_t popAll(QueuedKey* keys, size_t max_keys);
+
+    private:
+      struct Slot
+      {
+        std::atomic<size_t> sequence;
+        QueuedKey key;
+      };
+
+      std::unique_ptr<Slot[]> slots_;
+      size_t mask_;
+      OverflowPolicy policy_;
+      int event_fd_;
+
+      // producers and the consumer each get their own cache line
+      char tail_pad_[64];
+      std::atomic<size_t> tail_;
+      char head_pad_[64];
+      std::atomic<size_t> head_;
+      std::atomic<uint64_t> overflows_;
+      std::atomic<bool> closed_;
+  };
+
+
+  class KeyQueueException: public std::exception
+  {
+    private:
+      std::string message_;
+
+    public:
+      KeyQueueException(const std::string& message) : message_(message)
+      {
+      }
+
+      virtual const char* what() const throw()
+      {
+        return message_.c_str();
+      }
+  };
+};
+#endif
@@ -0,0 +1,73 @@
+#include "keytable.h"
+
+namespace KeyTable
+{
+  KeyTable::KeyTable(void)
+  {
+    clear();
+  }
+
+
+  void KeyTable::clear(void)
+  {
+    for (int i = 0; i < SIZE; i++)
+    {
+      bindings_[i].chord.count = 0;
+      bindings_[i].macro = -1;
+    }
+
+    macros_.clear();
+  }
+
+
+  void KeyTable::set(CEC::cec_user_control_code cec_control_code,
+                     int input_key)
+  {
+    set(cec_control_code, UserInputDevice::singleKey(input_key));
+  }
+
+
+  void KeyTable::set(CEC::cec_user_control_code cec_control_code,
+                     const UserInputDevice::Chord& chord)
+  {
+    Binding& binding = bindings_[cec_control_code & (SIZE - 1)];
+    binding.chord = chord;
+    binding.macro = -1;
+  }
+
+
+  void KeyTable::setMacro(CEC::cec_user_control_code cec_control_code,
+                          int macro)
+  {
+    Binding& binding = bindings_[cec_control_code & (SIZE - 1)];
+    binding.chord.count = 0;
+    binding.macro = macro;
+  }
+
+
+  int KeyTable::addMacro(const Macro& macro)
+  {
+    macros_.push_back(macro);
+    return macros_.size() - 1;
+  }
+
+
+  int KeyTable::findMacro(const std::string& name) const
+  {
+    for (size_t i = 0; i < macros_.size(); i++)
+    {
+      if (macros_[i].name.compare(name) == 0)
+      {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+
+  const std::vector<Macro>& KeyTable::macros(void) const
+  {
+    return macros_;
+  }
+};
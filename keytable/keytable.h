@@ -0,0 +1,84 @@
+#ifndef KEYTABLE_H
+#define KEYTABLE_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libcec/cectypes.h"
+
+#include "../inputdevice/inputdevice.h"
+
+namespace KeyTable
+{
+  // One step of a macro, written KEY_NAME[*count][@delay_ms]: tap the key
+  // count times, waiting delay_ms after each tap. The key can be a chord
+  // such as KEY_LEFTCTRL+KEY_W.
+  struct Step
+  {
+    UserInputDevice::Chord chord;
+    uint32_t count;
+    uint32_t delay_ms;
+  };
+
+  typedef std::vector<Step> Sequence;
+
+  struct Macro
+  {
+    std::string name;
+    std::shared_ptr<const Sequence> sequence;
+  };
+
+
+  // What a CEC user control code is mapped to
+  struct Binding
+  {
+    UserInputDevice::Chord chord; // keys to send, count is 0 if none
+    int macro;                    // index of a macro to play, -1 if none
+  };
+
+
+  // Flat CEC user control code to input key table. Every possible code has
+  // an entry, so a lookup is a single indexed load with no branching on the
+  // map structure. Unmapped codes have no keys and no macro. The macros the
+  // table refers to are kept with it, so a table and its macros are always
+  // replaced together.
+  class KeyTable
+  {
+    public:
+      static const int SIZE = 256;
+
+      KeyTable(void);
+
+      void clear(void);
+      void set(CEC::cec_user_control_code cec_control_code, int input_key);
+      void set(CEC::cec_user_control_code cec_control_code,
+               const UserInputDevice::Chord& chord);
+      void setMacro(CEC::cec_user_control_code cec_control_code, int macro);
+
+      // returns the index of the new macro
+      int addMacro(const Macro& macro);
+      int findMacro(const std::string& name) const;
+      const std::vector<Macro>& macros(void) const;
+
+      // first key of the code's chord
+      inline int lookup(CEC::cec_user_control_code cec_control_code) const
+      {
+        const Binding& binding = bindings_[cec_control_code & (SIZE - 1)];
+        return (binding.chord.count > 0) ? binding.chord.keys[0] : -1;
+      }
+
+      inline const Binding& binding(
+        CEC::cec_user_control_code cec_control_code) const
+      {
+        return bindings_[cec_control_code & (SIZE - 1)];
+      }
+
+    private:
+      Binding bindings_[SIZE];
+      std::vector<Macro> macros_;
+  };
+};
+#endif
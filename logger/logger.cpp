@@ -0,0 +1,272 @@
+#include "logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace Logger
+{
+  static std::atomic<Logger*> installed(NULL);
+
+
+  bool parseLevel(const std::string& name, Level* level)
+  {
+    static const char* names[] = {"error", "warning", "info", "debug"};
+
+    for (int i = LEVEL_ERROR; i <= LEVEL_DEBUG; i++)
+    {
+      if (name.compare(names[i]) == 0)
+      {
+        *level = (Level) i;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  bool parseOutput(const std::string& name, Output* output)
+  {
+    if (name.compare("console") == 0)
+    {
+      *output = OUTPUT_CONSOLE;
+      return true;
+    }
+
+    if (name.compare("syslog") == 0)
+    {
+      *output = OUTPUT_SYSLOG;
+      return true;
+    }
+
+    return false;
+  }
+
+
+  Logger::Logger(Level level, Output output, size_t capacity) :
+    level_(level), output_(output), stopped_(false), tail_(0), head_(0),
+    dropped_(0)
+  {
+    size_t rounded = 1;
+    while (rounded < capacity)
+    {
+      rounded <<= 1;
+    }
+
+    slots_.reset(new Slot[rounded]);
+    mask_ = rounded - 1;
+
+    for (size_t i = 0; i < rounded; i++)
+    {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+
+    if (event_fd_ < 0)
+    {
+      throw LoggerException(strerror(errno));
+    }
+
+    if (output_ == OUTPUT_SYSLOG)
+    {
+      openlog("cec_keyboard", LOG_PID, LOG_DAEMON);
+    }
+
+    thread_ = std::thread(&Logger::run, this);
+  }
+
+
+  Logger::~Logger(void)
+  {
+    Logger* self = this;
+    installed.compare_exchange_strong(self, NULL);
+
+    stopped_ = true;
+    notify();
+    thread_.join();
+
+    close(event_fd_);
+
+    if (output_ == OUTPUT_SYSLOG)
+    {
+      closelog();
+    }
+  }
+
+
+  bool Logger::enabled(Level level) const
+  {
+    return level <= level_;
+  }
+
+
+  void Logger::log(Level level, const char* format, va_list args)
+  {
+    if (!enabled(level))
+    {
+      return;
+    }
+
+    size_t pos = tail_.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Slot& slot = slots_[pos & mask_];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+        {
+          // the slot is ours until it is published, so the message is
+          // formatted in place
+          slot.level = level;
+          vsnprintf(slot.text, sizeof(slot.text), format, args);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          notify();
+          return;
+        }
+      }
+      else if (diff < 0)
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+
+  void Logger::notify(void)
+  {
+    uint64_t one = 1;
+    if (::write(event_fd_, &one, sizeof(one)) < 0)
+    {
+      return;
+    }
+  }
+
+
+  uint64_t Logger::dropped(void) const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+
+  void Logger::write(Level level, const char* text)
+  {
+    if (output_ == OUTPUT_SYSLOG)
+    {
+      static const int priorities[] = {LOG_ERR, LOG_WARNING, LOG_INFO,
+                                       LOG_DEBUG};
+      syslog(priorities[level], "%s", text);
+      return;
+    }
+
+    FILE* stream = (level <= LEVEL_WARNING) ? stderr : stdout;
+    fputs(text, stream);
+    fputc('\n', stream);
+  }
+
+
+  // writer thread only, returns the number of messages written
+  size_t Logger::drain(void)
+  {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    size_t count = 0;
+
+    for (;;)
+    {
+      Slot& slot = slots_[pos & mask_];
+
+      if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+      {
+        break;
+      }
+
+      write(slot.level, slot.text);
+      slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+      head_.store(++pos, std::memory_order_relaxed);
+      count++;
+    }
+
+    return count;
+  }
+
+
+  void Logger::run(void)
+  {
+    uint64_t reported_drops = 0;
+
+    for (;;)
+    {
+      uint64_t pending;
+      if ((read(event_fd_, &pending, sizeof(pending)) < 0) && (errno != EINTR))
+      {
+        return;
+      }
+
+      bool stopping = stopped_;
+
+      // flushed once per batch rather than once per line
+      if (drain() > 0)
+      {
+        uint64_t drops = dropped();
+        if (drops != reported_drops)
+        {
+          char text[64];
+          snprintf(text, sizeof(text), "%llu log messages dropped",
+                   (unsigned long long) (drops - reported_drops));
+          write(LEVEL_WARNING, text);
+          reported_drops = drops;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+      }
+
+      if (stopping)
+      {
+        return;
+      }
+    }
+  }
+
+
+  void install(Logger* logger)
+  {
+    installed = logger;
+  }
+
+
+  void log(Level level, const char* format, ...)
+  {
+    va_list args;
+    va_start(args, format);
+
+    Logger* logger = installed;
+    if (logger)
+    {
+      logger->log(level, format, args);
+    }
+    else if (level <= LEVEL_INFO)
+    {
+      FILE* stream = (level <= LEVEL_WARNING) ? stderr : stdout;
+      vfprintf(stream, format, args);
+      fputc('\n', stream);
+      fflush(stream);
+    }
+
+    va_end(args);
+  }
+};
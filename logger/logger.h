@@ -0,0 +1,112 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace Logger
+{
+  enum Level
+  {
+    LEVEL_ERROR,
+    LEVEL_WARNING,
+    LEVEL_INFO,
+    LEVEL_DEBUG
+  };
+
+  enum Output
+  {
+    OUTPUT_CONSOLE, // errors and warnings to stderr, the rest to stdout
+    OUTPUT_SYSLOG   // syslog(3), which journald collects directly
+  };
+
+  // "error", "warning", "info" or "debug"
+  bool parseLevel(const std::string& name, Level* level);
+
+  // "console" or "syslog"
+  bool parseOutput(const std::string& name, Output* output);
+
+
+  // Messages are formatted straight into a slot of a bounded lock-free ring
+  // and written out by a background thread, so logging never waits for
+  // stdout or the journal. When the ring is full new messages are dropped
+  // and counted rather than blocking the caller.
+  class Logger
+  {
+    public:
+      static const size_t MAX_MESSAGE = 256; // longer messages are truncated
+
+      Logger(Level level, Output output, size_t capacity = 1024);
+
+      // writes out anything still in the ring and uninstalls the logger,
+      // no other thread may be logging through it
+      ~Logger();
+
+      bool enabled(Level level) const;
+
+      // safe to call from any thread
+      void log(Level level, const char* format, va_list args);
+
+      uint64_t dropped(void) const;
+
+    private:
+      struct Slot
+      {
+        std::atomic<size_t> sequence;
+        Level level;
+        char text[MAX_MESSAGE];
+      };
+
+      Level level_;
+      Output output_;
+      std::unique_ptr<Slot[]> slots_;
+      size_t mask_;
+      int event_fd_;
+      std::atomic<bool> stopped_;
+      std::thread thread_;
+
+      char tail_pad_[64];
+      std::atomic<size_t> tail_;
+      char head_pad_[64];
+      std::atomic<size_t> head_;
+      std::atomic<uint64_t> dropped_;
+
+      void notify(void);
+      void write(Level level, const char* text);
+      size_t drain(void);
+      void run(void);
+  };
+
+
+  // Makes logger the destination for log(), or NULL to go back to writing
+  // synchronously to the console, which is what happens before one is
+  // installed. The caller keeps ownership.
+  void install(Logger* logger);
+
+  void log(Level level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+
+  class LoggerException: public std::exception
+  {
+    private:
+      std::string message_;
+
+    public:
+      LoggerException(const std::string& message) : message_(message)
+      {
+      }
+
+      virtual const char* what() const throw()
+      {
+        return message_.c_str();
+      }
+  };
+};
+#endif
@@ -0,0 +1,176 @@
+#include "macrorunner.h"
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include <sstream>
+
+#include "../ceckeymap.h"
+#include "../stats/stats.h"
+
+namespace MacroRunner
+{
+  static bool parseCount(const std::string& text, uint32_t max,
+                         uint32_t* value)
+  {
+    char* remain;
+    errno = 0;
+    long int raw = strtol(text.c_str(), &remain, 10);
+
+    if (text.empty() || (errno != 0) || (*remain != '\0') || (raw < 0) ||
+        (raw > (long int) max))
+    {
+      return false;
+    }
+
+    *value = raw;
+    return true;
+  }
+
+
+  bool parseStep(const std::string& text, uint32_t default_delay_ms,
+                 KeyTable::Step* step)
+  {
+    std::string key_name = text;
+    step->count = 1;
+    step->delay_ms = default_delay_ms;
+
+    size_t delay_at = key_name.find('@');
+    if (delay_at != std::string::npos)
+    {
+      if (!parseCount(key_name.substr(delay_at + 1), 60000, &step->delay_ms))
+      {
+        return false;
+      }
+      key_name.resize(delay_at);
+    }
+
+    size_t count_at = key_name.find('*');
+    if (count_at != std::string::npos)
+    {
+      if (!parseCount(key_name.substr(count_at + 1), 1000, &step->count) ||
+          (step->count == 0))
+      {
+        return false;
+      }
+      key_name.resize(count_at);
+    }
+
+    return getInputChord(key_name, &step->chord);
+  }
+
+
+  bool parseSequence(const std::string& text, uint32_t default_delay_ms,
+                     size_t max_keys, KeyTable::Sequence* sequence)
+  {
+    std::istringstream stream(text);
+    std::string step_text;
+    size_t keys = 0;
+    sequence->clear();
+
+    // checked as it is parsed, so a huge sequence is turned away before
+    // much of it is stored
+    while (std::getline(stream, step_text, ','))
+    {
+      KeyTable::Step step;
+      if (!parseStep(step_text, default_delay_ms, &step))
+      {
+        return false;
+      }
+
+      keys += step.count;
+      if (keys > max_keys)
+      {
+        return false;
+      }
+      sequence->push_back(step);
+    }
+
+    return !sequence->empty();
+  }
+
+
+  size_t keyCount(const KeyTable::Sequence& sequence)
+  {
+    size_t keys = 0;
+    for (size_t i = 0; i < sequence.size(); i++)
+    {
+      keys += sequence[i].count;
+    }
+    return keys;
+  }
+
+
+  std::string stepToString(const KeyTable::Step& step)
+  {
+    std::ostringstream text;
+    text << getChordStr(step.chord);
+
+    if (step.count != 1)
+    {
+      text << "*" << step.count;
+    }
+
+    text << "@" << step.delay_ms;
+    return text.str();
+  }
+
+
+  MacroRunner::MacroRunner(KeyPipeline::KeyPipeline* pipeline,
+                           Scheduler::Scheduler* scheduler) :
+    pipeline_(pipeline), scheduler_(scheduler)
+  {
+  }
+
+
+  void MacroRunner::run(std::shared_ptr<const KeyTable::Sequence> sequence,
+                        KeyQueue::KeySource source, Completion done)
+  {
+    std::shared_ptr<Playback> playback = std::make_shared<Playback>();
+    playback->sequence = sequence;
+    playback->step = 0;
+    playback->repeat = 0;
+    playback->source = source;
+    playback->done = done;
+    playback->success = true;
+
+    advance(playback);
+  }
+
+
+  void MacroRunner::advance(std::shared_ptr<Playback> playback)
+  {
+    const KeyTable::Sequence& sequence = *playback->sequence;
+
+    // keys with no delay after them are queued straight away, the first
+    // step with a delay hands the rest of the sequence to the scheduler
+    while (playback->step < sequence.size())
+    {
+      const KeyTable::Step& step = sequence[playback->step];
+
+      playback->success &=
+        pipeline_->queueKey(step.chord, UserInputDevice::ACTION_TAP,
+                            playback->source, Stats::monotonicNs());
+
+      if (++playback->repeat >= step.count)
+      {
+        playback->step++;
+        playback->repeat = 0;
+      }
+
+      if ((step.delay_ms > 0) && (playback->step < sequence.size()))
+      {
+        scheduler_->schedule(step.delay_ms, [this, playback]()
+        {
+          advance(playback);
+        });
+        return;
+      }
+    }
+
+    if (playback->done)
+    {
+      playback->done(playback->success);
+    }
+  }
+};
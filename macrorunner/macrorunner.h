@@ -0,0 +1,67 @@
+#ifndef MACRORUNNER_H
+#define MACRORUNNER_H
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../keypipeline/keypipeline.h"
+#include "../keyqueue/keyqueue.h"
+#include "../keytable/keytable.h"
+#include "../scheduler/scheduler.h"
+
+namespace MacroRunner
+{
+  // called once every key in the sequence has been queued, success is false
+  // if any of them were dropped
+  typedef std::function<void(bool success)> Completion;
+
+  // see KeyTable::Step for the format
+  bool parseStep(const std::string& text, uint32_t default_delay_ms,
+                 KeyTable::Step* step);
+
+  // comma separated steps, e.g. "KEY_HOME@200,KEY_DOWN*5@80,KEY_ENTER".
+  // Fails if the sequence would send more than max_keys keys in total.
+  bool parseSequence(const std::string& text, uint32_t default_delay_ms,
+                     size_t max_keys, KeyTable::Sequence* sequence);
+
+  // keys the sequence sends in total, counting repeats
+  size_t keyCount(const KeyTable::Sequence& sequence);
+
+  std::string stepToString(const KeyTable::Step& step);
+
+
+  // Plays key sequences into the key pipeline. Delays are timed by the
+  // scheduler, so neither the caller nor the dispatch loop waits for them.
+  class MacroRunner
+  {
+    public:
+      MacroRunner(KeyPipeline::KeyPipeline* pipeline,
+                  Scheduler::Scheduler* scheduler);
+
+      // safe to call from any thread, the first keys are queued before it
+      // returns
+      void run(std::shared_ptr<const KeyTable::Sequence> sequence,
+               KeyQueue::KeySource source, Completion done);
+
+    private:
+      struct Playback
+      {
+        std::shared_ptr<const KeyTable::Sequence> sequence;
+        size_t step;
+        uint32_t repeat;
+        KeyQueue::KeySource source;
+        Completion done;
+        bool success;
+      };
+
+      KeyPipeline::KeyPipeline* pipeline_;
+      Scheduler::Scheduler* scheduler_;
+
+      void advance(std::shared_ptr<Playback> playback);
+  };
+};
+#endif
@@ -0,0 +1,97 @@
+#include "metrics.h"
+
+namespace Metrics
+{
+  const std::vector<uint64_t> LATENCY_BOUNDS_NS =
+  {
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000,
+    50000000, 100000000, 250000000, 500000000, 1000000000, 2500000000
+  };
+
+
+  std::string label(const std::string& name, const std::string& value)
+  {
+    std::string text = name + "=\"";
+
+    for (size_t i = 0; i < value.size(); i++)
+    {
+      switch (value[i])
+      {
+        case '\\':
+          text += "\\\\";
+          break;
+        case '"':
+          text += "\\\"";
+          break;
+        case '\n':
+          text += "\\n";
+          break;
+        default:
+          text += value[i];
+          break;
+      }
+    }
+
+    return text + "\"";
+  }
+
+
+  Metrics::Metrics(void)
+  {
+    // enough digits that sums in seconds keep microsecond resolution
+    out_.precision(15);
+  }
+
+
+  void Metrics::family(const std::string& name, const std::string& type,
+                       const std::string& help)
+  {
+    out_ << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " " << type << "\n";
+  }
+
+
+  void Metrics::sample(const std::string& name, const std::string& labels,
+                       uint64_t value)
+  {
+    out_ << name;
+    if (!labels.empty())
+    {
+      out_ << "{" << labels << "}";
+    }
+    out_ << " " << value << "\n";
+  }
+
+
+  void Metrics::histogram(const std::string& name, const std::string& labels,
+                          const Stats::Histogram& histogram,
+                          const std::vector<uint64_t>& bounds, double scale)
+  {
+    std::string separator = labels.empty() ? "" : ",";
+
+    // the count is read first, so no bucket can exceed it
+    uint64_t count = histogram.count();
+
+    for (size_t i = 0; i < bounds.size(); i++)
+    {
+      uint64_t at_or_below = histogram.countAtOrBelow(bounds[i]);
+      out_ << name << "_bucket{" << labels << separator << "le=\""
+           << bounds[i] / scale << "\"} "
+           << ((at_or_below < count) ? at_or_below : count) << "\n";
+    }
+
+    out_ << name << "_bucket{" << labels << separator << "le=\"+Inf\"} "
+         << count << "\n";
+
+    std::string braced_labels = labels.empty() ? "" : "{" + labels + "}";
+    out_ << name << "_sum" << braced_labels << " "
+         << histogram.sum() / scale << "\n"
+         << name << "_count" << braced_labels << " " << count << "\n";
+  }
+
+
+  std::string Metrics::text(void) const
+  {
+    return out_.str();
+  }
+};
@@ -0,0 +1,47 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../stats/stats.h"
+
+namespace Metrics
+{
+  // upper bounds, in nanoseconds, of the buckets latencies are reported in
+  extern const std::vector<uint64_t> LATENCY_BOUNDS_NS;
+
+  // name="value", with the value escaped
+  std::string label(const std::string& name, const std::string& value);
+
+
+  // Builds a page in the Prometheus text exposition format. Each family is
+  // started with family() and followed by its samples.
+  class Metrics
+  {
+    public:
+      Metrics(void);
+
+      void family(const std::string& name, const std::string& type,
+                  const std::string& help);
+
+      // labels are comma separated label() results, or empty
+      void sample(const std::string& name, const std::string& labels,
+                  uint64_t value);
+
+      // the histogram's values are divided by scale, e.g. 1e9 to report
+      // nanoseconds as seconds
+      void histogram(const std::string& name, const std::string& labels,
+                     const Stats::Histogram& histogram,
+                     const std::vector<uint64_t>& bounds, double scale);
+
+      std::string text(void) const;
+
+    private:
+      std::ostringstream out_;
+  };
+};
+#endif
@@ -0,0 +1,97 @@
+#include "ratelimiter.h"
+
+#include "../stats/stats.h"
+
+namespace RateLimiter
+{
+  RateLimiter::RateLimiter(const Limit limits[TARGETS])
+  {
+    for (int i = 0; i < TARGETS; i++)
+    {
+      limits_[i] = limits[i];
+      rate_limited_[i] = 0;
+      busy_[i] = 0;
+    }
+  }
+
+
+  Decision RateLimiter::admit(websocketpp::connection_hdl hdl, Target target,
+                              size_t count, size_t queued)
+  {
+    const Limit& limit = limits_[target];
+
+    if ((limit.max_queued > 0) && (queued + count > limit.max_queued))
+    {
+      busy_[target]++;
+      return BUSY;
+    }
+
+    if (limit.rate <= 0)
+    {
+      return ADMITTED;
+    }
+
+    uint64_t now_ns = Stats::monotonicNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Clients::iterator client = clients_.find(hdl);
+    if (client == clients_.end())
+    {
+      // new clients start with a full bucket
+      ClientState state;
+      for (int i = 0; i < TARGETS; i++)
+      {
+        state.buckets[i].tokens = limits_[i].burst;
+        state.buckets[i].updated_ns = now_ns;
+      }
+      client = clients_.insert(std::make_pair(hdl, state)).first;
+    }
+
+    Bucket& bucket = client->second.buckets[target];
+    bucket.tokens += (now_ns - bucket.updated_ns) * limit.rate / 1e9;
+    if (bucket.tokens > limit.burst)
+    {
+      bucket.tokens = limit.burst;
+    }
+    bucket.updated_ns = now_ns;
+
+    if (bucket.tokens < count)
+    {
+      rate_limited_[target]++;
+      return RATE_LIMITED;
+    }
+
+    bucket.tokens -= count;
+    return ADMITTED;
+  }
+
+
+  void RateLimiter::remove(websocketpp::connection_hdl hdl)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_.erase(hdl);
+  }
+
+
+  uint64_t RateLimiter::rejected(Target target, Decision reason) const
+  {
+    if (reason == RATE_LIMITED)
+    {
+      return rate_limited_[target];
+    }
+
+    if (reason == BUSY)
+    {
+      return busy_[target];
+    }
+
+    return 0;
+  }
+
+
+  size_t RateLimiter::clients(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_.size();
+  }
+};
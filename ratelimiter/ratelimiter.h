@@ -0,0 +1,83 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+
+namespace RateLimiter
+{
+  // the kinds of work a client can queue, each limited separately
+  enum Target
+  {
+    TARGET_KEY,
+    TARGET_CEC,
+    TARGETS
+  };
+
+  enum Decision
+  {
+    ADMITTED,
+    RATE_LIMITED, // the client has used up its share
+    BUSY          // too much work is already queued across all clients
+  };
+
+  struct Limit
+  {
+    double rate;       // commands per second, 0 for no limit
+    double burst;      // commands that can be sent at once after a pause
+    size_t max_queued; // work queued by all clients, 0 for no limit
+  };
+
+
+  // Admission control for websocket clients. Every connection has a token
+  // bucket per target, so one client sending faster than its rate is
+  // turned away without slowing down the others, and all clients are
+  // turned away while the queue a command would go into is already full
+  // enough to delay a key press noticeably.
+  class RateLimiter
+  {
+    public:
+      RateLimiter(const Limit limits[TARGETS]);
+
+      // count commands for target from the client at hdl, queued is the
+      // amount of work already waiting for that target. Nothing is taken
+      // from the client's bucket unless the commands are admitted.
+      Decision admit(websocketpp::connection_hdl hdl, Target target,
+                     size_t count, size_t queued);
+
+      // forgets a client once its connection has closed
+      void remove(websocketpp::connection_hdl hdl);
+
+      uint64_t rejected(Target target, Decision reason) const;
+      size_t clients(void);
+
+    private:
+      struct Bucket
+      {
+        double tokens;
+        uint64_t updated_ns;
+      };
+
+      struct ClientState
+      {
+        Bucket buckets[TARGETS];
+      };
+
+      typedef std::map<websocketpp::connection_hdl, ClientState,
+                       std::owner_less<websocketpp::connection_hdl> > Clients;
+
+      Limit limits_[TARGETS];
+      std::mutex mutex_;
+      Clients clients_;
+      std::atomic<uint64_t> rate_limited_[TARGETS];
+      std::atomic<uint64_t> busy_[TARGETS];
+  };
+};
+#endif
@@ -0,0 +1,269 @@
+#include "recorder.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../logger/logger.h"
+
+namespace Recorder
+{
+  static const char MAGIC[] = "CECKREC";
+
+
+  static void putLE(uint8_t* bytes, uint64_t value, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+  }
+
+
+  static uint64_t getLE(const uint8_t* bytes, size_t size)
+  {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+      value |= (uint64_t) bytes[i] << (8 * i);
+    }
+    return value;
+  }
+
+
+  Recorder::Recorder(const std::string& path) :
+    records_(0), failed_(false)
+  {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+      throw RecorderException(path + ": " + strerror(errno));
+    }
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, MAGIC, HEADER_SIZE - 1);
+    header[HEADER_SIZE - 1] = VERSION;
+
+    if (fwrite(header, sizeof(header), 1, file_) != 1)
+    {
+      fclose(file_);
+      throw RecorderException(path + ": " + strerror(errno));
+    }
+  }
+
+
+  Recorder::~Recorder(void)
+  {
+    fclose(file_);
+  }
+
+
+  void Recorder::keyPress(uint8_t adapter, const CEC::cec_keypress& key,
+                          uint64_t received_ns)
+  {
+    uint8_t payload[5];
+    payload[0] = (uint8_t) key.keycode;
+    putLE(payload + 1, key.duration, 4);
+
+    write(RECORD_KEY_PRESS, received_ns, adapter, payload, sizeof(payload));
+  }
+
+
+  void Recorder::wsMessage(uint8_t adapter, bool binary,
+                           const std::string& payload, uint64_t received_ns)
+  {
+    write(binary ? RECORD_WS_BINARY : RECORD_WS_TEXT, received_ns, adapter,
+          payload.data(), payload.size());
+  }
+
+
+  uint64_t Recorder::records(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+  }
+
+
+  void Recorder::write(RecordType type, uint64_t received_ns, uint8_t adapter,
+                       const void* payload, uint32_t length)
+  {
+    // a message too long to be replayed is left out
+    if (length >= MAX_PAYLOAD)
+    {
+      return;
+    }
+
+    // the adapter is the first byte of every payload
+    uint8_t header[RECORD_HEADER_SIZE + 1];
+    header[0] = (uint8_t) type;
+    putLE(header + 1, received_ns, 8);
+    putLE(header + 9, length + 1, 4);
+    header[RECORD_HEADER_SIZE] = adapter;
+
+    // header and payload are written together so records from different
+    // threads never interleave
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((fwrite(header, sizeof(header), 1, file_) != 1) ||
+        ((length > 0) && (fwrite(payload, length, 1, file_) != 1)) ||
+        (fflush(file_) != 0))
+    {
+      if (!failed_)
+      {
+        Logger::log(Logger::LEVEL_ERROR, "Failed to write recording: %s",
+                    strerror(errno));
+        failed_ = true;
+      }
+      return;
+    }
+
+    records_++;
+  }
+
+
+  Player::Player(const std::string& path) :
+    version_(0), stopped_(false), played_(0)
+  {
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_)
+    {
+      throw RecorderException(path + ": " + strerror(errno));
+    }
+
+    uint8_t header[HEADER_SIZE];
+    if ((fread(header, sizeof(header), 1, file_) != 1) ||
+        (memcmp(header, MAGIC, HEADER_SIZE - 1) != 0))
+    {
+      fclose(file_);
+      throw RecorderException(path + ": not a recording");
+    }
+
+    version_ = header[HEADER_SIZE - 1];
+    if ((version_ < 1) || (version_ > VERSION))
+    {
+      fclose(file_);
+      throw RecorderException(path + ": unsupported recording version");
+    }
+  }
+
+
+  Player::~Player(void)
+  {
+    fclose(file_);
+  }
+
+
+  bool Player::play(double speed, KeyPressHandler key_press,
+                    MessageHandler message)
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point start = Clock::now();
+    uint64_t first_ns = 0;
+    std::vector<uint8_t> payload;
+
+    while (!stopped_)
+    {
+      uint8_t header[RECORD_HEADER_SIZE];
+      size_t header_read = fread(header, 1, sizeof(header), file_);
+      if (header_read == 0)
+      {
+        return feof(file_) != 0;
+      }
+      else if (header_read != sizeof(header))
+      {
+        return false;
+      }
+
+      uint8_t type = header[0];
+      uint64_t received_ns = getLE(header + 1, 8);
+      uint32_t length = (uint32_t) getLE(header + 9, 4);
+
+      if (length > MAX_PAYLOAD)
+      {
+        return false;
+      }
+
+      payload.resize(length);
+      if ((length > 0) && (fread(payload.data(), length, 1, file_) != 1))
+      {
+        return false;
+      }
+
+      if (played_ == 0)
+      {
+        first_ns = received_ns;
+      }
+
+      if ((speed > 0) && (received_ns > first_ns))
+      {
+        Clock::time_point due = start + std::chrono::nanoseconds(
+          (uint64_t) ((received_ns - first_ns) / speed));
+
+        // slept in short steps so stop() is noticed during long gaps
+        while (!stopped_ && (Clock::now() < due))
+        {
+          Clock::duration step = due - Clock::now();
+          if (step > std::chrono::milliseconds(100))
+          {
+            step = std::chrono::milliseconds(100);
+          }
+          std::this_thread::sleep_for(step);
+        }
+      }
+
+      uint8_t adapter = 0;
+      size_t offset = 0;
+      if (version_ >= 2)
+      {
+        if (length == 0)
+        {
+          return false;
+        }
+
+        adapter = payload[0];
+        offset = 1;
+      }
+
+      if (type == RECORD_KEY_PRESS)
+      {
+        if (length != offset + 5)
+        {
+          return false;
+        }
+
+        CEC::cec_keypress key;
+        key.keycode = (CEC::cec_user_control_code) payload[offset];
+        key.duration = (unsigned int) getLE(payload.data() + offset + 1, 4);
+        key_press(adapter, key);
+      }
+      else if ((type == RECORD_WS_TEXT) || (type == RECORD_WS_BINARY))
+      {
+        message(adapter, type == RECORD_WS_BINARY,
+                std::string(payload.begin() + offset, payload.end()));
+      }
+      else
+      {
+        return false;
+      }
+
+      played_++;
+    }
+
+    return true;
+  }
+
+
+  void Player::stop(void)
+  {
+    stopped_ = true;
+  }
+
+
+  uint64_t Player::played(void) const
+  {
+    return played_;
+  }
+};
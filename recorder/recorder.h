@@ -0,0 +1,122 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <libcec/cec.h>
+
+// Log of the input the daemon received, for replaying later. All
+// multi-byte fields are little-endian.
+//
+// file:   | "CECKREC" | version (1) | record ... |
+// record: | type (1) | time_ns (8) | length (4) | payload (length) |
+//
+// time_ns is the monotonic time the input was received, adapter is the
+// position of the adapter it was for in the configured list.
+// KEY_PRESS payload: | adapter (1) | keycode (1) | duration (4) |
+// WS_TEXT, WS_BINARY payload: | adapter (1) | the message as received |
+//
+// Version 1 logs have no adapter fields and are played to the first
+// adapter.
+
+namespace Recorder
+{
+  static const uint8_t VERSION = 2;
+  static const size_t HEADER_SIZE = 8;
+  static const size_t RECORD_HEADER_SIZE = 13;
+  // longer payloads are taken as a corrupt log rather than allocated
+  static const uint32_t MAX_PAYLOAD = 1024 * 1024;
+
+  enum RecordType
+  {
+    RECORD_KEY_PRESS = 0x01,
+    RECORD_WS_TEXT   = 0x02,
+    RECORD_WS_BINARY = 0x03
+  };
+
+
+  // Appends records to a log file. Each record is written and flushed under
+  // a lock, so the records leading up to a crash are kept; recording is for
+  // capturing traces rather than for normal running.
+  class Recorder
+  {
+    public:
+      Recorder(const std::string& path);
+      ~Recorder();
+
+      // safe to call from any thread
+      void keyPress(uint8_t adapter, const CEC::cec_keypress& key,
+                    uint64_t received_ns);
+      void wsMessage(uint8_t adapter, bool binary, const std::string& payload,
+                     uint64_t received_ns);
+
+      uint64_t records(void);
+
+    private:
+      std::mutex mutex_;
+      FILE* file_;
+      uint64_t records_;
+      bool failed_; // a write has failed, only the first is logged
+
+      void write(RecordType type, uint64_t received_ns, uint8_t adapter,
+                 const void* payload, uint32_t length);
+  };
+
+
+  typedef std::function<void(uint8_t adapter, const CEC::cec_keypress& key)>
+    KeyPressHandler;
+  typedef std::function<void(uint8_t adapter, bool binary,
+                             const std::string& payload)> MessageHandler;
+
+
+  // Plays a log back through the handlers, on the calling thread.
+  class Player
+  {
+    public:
+      Player(const std::string& path);
+      ~Player();
+
+      // speed scales the gaps between records, 1 keeps the original timing,
+      // 2 plays twice as fast and 0 plays without waiting. Returns false if
+      // the log is truncated or corrupt, after playing the records before
+      // the damage.
+      bool play(double speed, KeyPressHandler key_press,
+                MessageHandler message);
+
+      // stops play() before the next record, safe to call from any thread
+      void stop(void);
+
+      uint64_t played(void) const;
+
+    private:
+      FILE* file_;
+      uint8_t version_;
+      std::atomic<bool> stopped_;
+      uint64_t played_;
+  };
+
+
+  class RecorderException: public std::exception
+  {
+    private:
+      std::string message_;
+
+    public:
+      RecorderException(const std::string& message) : message_(message)
+      {
+      }
+
+      virtual const char* what() const throw()
+      {
+        return message_.c_str();
+      }
+  };
+};
+#endif
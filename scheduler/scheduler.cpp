@@ -0,0 +1,152 @@
+#include "scheduler.h"
+
+namespace Scheduler
+{
+  Scheduler::Scheduler(uint32_t tick_ms) :
+    tick_(std::chrono::milliseconds(tick_ms > 0 ? tick_ms : 1)),
+    start_(Clock::now()), current_tick_(0), pending_(0), stopped_(false),
+    thread_(&Scheduler::run, this)
+  {
+  }
+
+
+  Scheduler::~Scheduler(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+
+    timers_changed_.notify_all();
+    thread_.join();
+  }
+
+
+  void Scheduler::schedule(uint32_t delay_ms, Task task)
+  {
+    // rounded up so a timer never fires before its delay has passed
+    Clock::time_point due = Clock::now() + std::chrono::milliseconds(delay_ms);
+    uint64_t tick = (due - start_ + tick_ - Clock::duration(1)) / tick_;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (pending_ == 0)
+      {
+        // nothing to expire while the wheel was idle, so skip straight to
+        // the present rather than walking the slots in between
+        current_tick_ = tickAt(Clock::now());
+      }
+
+      if (tick < current_tick_)
+      {
+        tick = current_tick_;
+      }
+
+      wheel_[tick % SLOTS].push_back({tick, task});
+      pending_++;
+    }
+
+    timers_changed_.notify_one();
+  }
+
+
+  size_t Scheduler::pending(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+  }
+
+
+  uint64_t Scheduler::tickAt(Clock::time_point time) const
+  {
+    return (time - start_) / tick_;
+  }
+
+
+  // called with mutex_ held and pending_ > 0
+  uint64_t Scheduler::nextOccupiedTick(void) const
+  {
+    for (uint64_t tick = current_tick_; tick < current_tick_ + SLOTS; tick++)
+    {
+      if (!wheel_[tick % SLOTS].empty())
+      {
+        return tick;
+      }
+    }
+
+    return current_tick_ + SLOTS;
+  }
+
+
+  // called with mutex_ held, moves every timer due by now_tick into due
+  void Scheduler::expire(uint64_t now_tick, std::vector<Task>* due)
+  {
+    // each slot only needs visiting once however far behind the wheel is
+    uint64_t last_tick = now_tick;
+    if (last_tick - current_tick_ >= SLOTS)
+    {
+      last_tick = current_tick_ + SLOTS - 1;
+    }
+
+    for (uint64_t tick = current_tick_; tick <= last_tick; tick++)
+    {
+      std::vector<Timer>& slot = wheel_[tick % SLOTS];
+      size_t kept = 0;
+
+      // timers in a slot can be due on later turns of the wheel
+      for (size_t i = 0; i < slot.size(); i++)
+      {
+        if (slot[i].tick <= now_tick)
+        {
+          due->push_back(slot[i].task);
+        }
+        else
+        {
+          slot[kept++] = slot[i];
+        }
+      }
+
+      slot.resize(kept);
+    }
+
+    pending_ -= due->size();
+    current_tick_ = now_tick + 1;
+  }
+
+
+  void Scheduler::run(void)
+  {
+    std::vector<Task> due;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopped_)
+    {
+      if (pending_ == 0)
+      {
+        timers_changed_.wait(lock);
+        continue;
+      }
+
+      uint64_t now_tick = tickAt(Clock::now());
+      uint64_t next_tick = nextOccupiedTick();
+
+      if (next_tick > now_tick)
+      {
+        timers_changed_.wait_until(lock, start_ + tick_ * next_tick);
+        continue;
+      }
+
+      expire(now_tick, &due);
+
+      // tasks may schedule more timers, so they run without the lock
+      lock.unlock();
+      for (size_t i = 0; i < due.size(); i++)
+      {
+        due[i]();
+      }
+      due.clear();
+      lock.lock();
+    }
+  }
+};
@@ -0,0 +1,63 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Scheduler
+{
+  typedef std::function<void(void)> Task;
+
+
+  // Hashed timer wheel with its own thread. Timers are kept in the slot for
+  // the tick they are due on, so scheduling and expiring a timer are O(1)
+  // however many are pending. The thread sleeps until the next occupied
+  // slot, or indefinitely when nothing is scheduled. Tasks run on the
+  // scheduler thread and should only do a small amount of work.
+  class Scheduler
+  {
+    public:
+      static const size_t SLOTS = 256;
+
+      Scheduler(uint32_t tick_ms = 1);
+      ~Scheduler();
+
+      // run task once delay_ms has passed, safe to call from any thread
+      // including from a task
+      void schedule(uint32_t delay_ms, Task task);
+
+      size_t pending(void);
+
+    private:
+      typedef std::chrono::steady_clock Clock;
+
+      struct Timer
+      {
+        uint64_t tick; // tick the timer expires on
+        Task task;
+      };
+
+      std::vector<Timer> wheel_[SLOTS];
+      Clock::duration tick_;
+      Clock::time_point start_;
+
+      std::mutex mutex_;
+      std::condition_variable timers_changed_;
+      uint64_t current_tick_; // next tick that has not been expired
+      size_t pending_;
+      bool stopped_;
+      std::thread thread_;
+
+      uint64_t tickAt(Clock::time_point time) const;
+      uint64_t nextOccupiedTick(void) const;
+      void expire(uint64_t now_tick, std::vector<Task>* due);
+      void run(void);
+  };
+};
+#endif
@@ -0,0 +1,118 @@
+#include "stats.h"
+
+namespace Stats
+{
+  Histogram::Histogram(void) : count_(0), max_(0), sum_(0)
+  {
+    for (int i = 0; i < BUCKETS; i++)
+    {
+      buckets_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+
+  int Histogram::bucketIndex(uint64_t value)
+  {
+    if (value < (uint64_t) SUB_BUCKETS)
+    {
+      return (int) value;
+    }
+
+    int exponent = 63 - __builtin_clzll(value);
+    int sub_bucket = (int) (value >> (exponent - SUB_BUCKET_BITS))
+                     & (SUB_BUCKETS - 1);
+
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+  }
+
+
+  uint64_t Histogram::bucketValue(int index)
+  {
+    if (index < SUB_BUCKETS)
+    {
+      return (uint64_t) index;
+    }
+
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub_bucket = (uint64_t) (index % SUB_BUCKETS);
+
+    // highest value that falls in the bucket
+    uint64_t low = (SUB_BUCKETS + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+    return low + (1ULL << (exponent - SUB_BUCKET_BITS)) - 1;
+  }
+
+
+  void Histogram::record(uint64_t value)
+  {
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while ((value > current) &&
+           !max_.compare_exchange_weak(current, value,
+                                       std::memory_order_relaxed))
+    {
+    }
+  }
+
+
+  uint64_t Histogram::count(void) const
+  {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+
+  uint64_t Histogram::max(void) const
+  {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+
+  uint64_t Histogram::sum(void) const
+  {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+
+  uint64_t Histogram::countAtOrBelow(uint64_t value) const
+  {
+    uint64_t seen = 0;
+    for (int i = 0; (i < BUCKETS) && (bucketValue(i) <= value); i++)
+    {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+    }
+
+    return seen;
+  }
+
+
+  uint64_t Histogram::percentile(double percent) const
+  {
+    uint64_t total = count();
+    if (total == 0)
+    {
+      return 0;
+    }
+
+    uint64_t target = (uint64_t) (total * percent / 100.0 + 0.5);
+    if (target < 1)
+    {
+      target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+
+      if (seen >= target)
+      {
+        uint64_t value = bucketValue(i);
+        return (value < max()) ? value : max();
+      }
+    }
+
+    return max();
+  }
+};
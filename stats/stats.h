@@ -0,0 +1,121 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+namespace Stats
+{
+  inline uint64_t monotonicNs(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+
+  // Log-linear histogram in the style of HdrHistogram. Values below
+  // SUB_BUCKETS are counted exactly and larger values land in one of
+  // SUB_BUCKETS buckets per power of two, so any reported percentile is
+  // within 1/SUB_BUCKETS of the recorded value. record() is wait-free and
+  // may be called from any thread.
+  class Histogram
+  {
+    public:
+      static const int SUB_BUCKET_BITS = 4;
+      static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+      static const int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+      Histogram(void);
+
+      void record(uint64_t value);
+
+      uint64_t count(void) const;
+      uint64_t max(void) const;
+      uint64_t sum(void) const;
+      uint64_t percentile(double percent) const;
+
+      // number of values recorded that are no greater than value, counting
+      // only buckets that lie entirely at or below it
+      uint64_t countAtOrBelow(uint64_t value) const;
+
+    private:
+      std::atomic<uint64_t> buckets_[BUCKETS];
+      std::atomic<uint64_t> count_;
+      std::atomic<uint64_t> max_;
+      std::atomic<uint64_t> sum_;
+
+      static int bucketIndex(uint64_t value);
+      static uint64_t bucketValue(int index);
+  };
+
+
+  struct PipelineStats
+  {
+    // time from libcec callback or websocket message receipt to the
+    // uinput write() that emitted the key
+    Histogram cec_latency_ns;
+    Histogram ws_latency_ns;
+
+    // number of keys drained from the queue on each dispatcher wakeup
+    Histogram drained_per_wakeup;
+
+    std::atomic<uint64_t> cec_keys;
+    std::atomic<uint64_t> ws_keys;
+    std::atomic<uint64_t> unmapped_codes;
+    std::atomic<uint64_t> wakeups;
+    std::atomic<uint64_t> write_errors;
+    std::atomic<uint64_t> failed_keys; // keys in the failed writes
+
+    // unmapped presses by CEC user control code
+    std::atomic<uint64_t> unmapped_by_code[256];
+
+    PipelineStats(void) :
+      cec_keys(0), ws_keys(0), unmapped_codes(0), wakeups(0),
+      write_errors(0), failed_keys(0)
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        unmapped_by_code[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  };
+
+
+  // outcome of each request for one CEC command, including those merged
+  // into another
+  struct CommandStats
+  {
+    Histogram latency_ns;
+    std::atomic<uint64_t> succeeded;
+    std::atomic<uint64_t> failed;
+
+    CommandStats(void) : succeeded(0), failed(0)
+    {
+    }
+  };
+
+
+  struct CECStats
+  {
+    // time from a CEC command being submitted to its completion, and the
+    // part of that spent waiting on the bus
+    Histogram latency_ns;
+    Histogram transmit_ns;
+
+    // commands already waiting when each one was submitted
+    Histogram queue_depth;
+
+    std::atomic<uint64_t> commands;
+    std::atomic<uint64_t> coalesced;  // merged into a waiting command
+    std::atomic<uint64_t> superseded; // replaced by a later command
+    std::atomic<uint64_t> failed;
+
+    CECStats(void) : commands(0), coalesced(0), superseded(0), failed(0)
+    {
+    }
+  };
+};
+#endif